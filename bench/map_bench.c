@@ -0,0 +1,129 @@
+#include "map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Map microbenchmarks over identifier keys like those the type checker uses.
+ * Only the Map API is used, so the benchmark can be built against another
+ * map.c to compare implementations; see TLANG_BENCH_MAP_SOURCE.
+ */
+
+#define KEY_LEN 16
+
+static double
+now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char (*
+make_keys(size_t n))[KEY_LEN] {
+    char (*keys)[KEY_LEN] = malloc(n * sizeof(*keys));
+    if (NULL == keys) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < n; i++) {
+        snprintf(keys[i], KEY_LEN, "var_%zu_x", i);
+    }
+    return keys;
+}
+
+static size_t *
+shuffled(size_t n, size_t count) {
+    size_t *order = malloc(count * sizeof(*order));
+    if (NULL == order) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        order[i] = i % n;
+    }
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = (size_t)rand() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    return order;
+}
+
+static Map *
+build(char (*keys)[KEY_LEN], size_t n) {
+    Map *map = Map();
+    for (size_t i = 0; i < n; i++) {
+        Map_put(map, keys[i], strlen(keys[i]), keys[i], NULL);
+    }
+    return map;
+}
+
+static void
+bench_get(size_t n) {
+    const size_t lookups = 2000000;
+    char (*keys)[KEY_LEN] = make_keys(n);
+    size_t *order = shuffled(n, lookups);
+    Map *map = build(keys, n);
+    size_t found = 0;
+    double start = now();
+    for (size_t i = 0; i < lookups; i++) {
+        const char *key = keys[order[i]];
+        found += !Map_get(map, key, strlen(key), NULL);
+    }
+    double elapsed = now() - start;
+    if (found != lookups) {
+        fprintf(stderr, "get: %zu of %zu keys found\n", found, lookups);
+        exit(EXIT_FAILURE);
+    }
+    printf("get-hit  %7zu entries  %7.1f ns/op\n",
+        n,
+        elapsed / lookups * 1e9);
+    delete_Map(map, NULL);
+    free(order);
+    free(keys);
+}
+
+static void
+bench_copy(size_t n) {
+    const size_t copies = 20;
+    char (*keys)[KEY_LEN] = make_keys(n);
+    Map *map = build(keys, n);
+    double start = now();
+    for (size_t i = 0; i < copies; i++) {
+        delete_Map(copy_Map(map, NULL), NULL);
+    }
+    double elapsed = now() - start;
+    printf("copy     %7zu entries  %7.2f ms/op\n",
+        n,
+        elapsed / copies * 1e3);
+    delete_Map(map, NULL);
+    free(keys);
+}
+
+static void
+bench_build(size_t n) {
+    const size_t builds = 100000;
+    char (*keys)[KEY_LEN] = make_keys(n);
+    double start = now();
+    for (size_t i = 0; i < builds; i++) {
+        delete_Map(build(keys, n), NULL);
+    }
+    double elapsed = now() - start;
+    printf("build    %7zu entries  %7.2f us/op\n",
+        n,
+        elapsed / builds * 1e6);
+    free(keys);
+}
+
+int
+main(void) {
+    srand(1);
+    for (size_t n = 100; n <= 100000; n *= 10) {
+        bench_get(n);
+    }
+    bench_copy(100000);
+    bench_build(64);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+
+#define Arena(parent) new_Arena(parent)
+
+typedef struct Arena Arena;
+
+/*
+ * Allocate size bytes from the arena, aligned for any object type. The memory
+ * stays valid until the arena is deleted. If arena is NULL, the memory comes
+ * from malloc() instead.
+ */
+void *
+Arena_alloc(Arena *arena, size_t size);
+
+/*
+ * Resize a block allocated from the arena, preserving its first
+ * min(old_size, new_size) bytes. The most recent allocation grows in place
+ * when there is room; otherwise the contents are moved to a new block and the
+ * old one is abandoned until the arena is deleted. If arena is NULL, this
+ * behaves like realloc().
+ */
+void *
+Arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/*
+ * Release a block allocated from the arena. Only heap blocks (arena is NULL)
+ * are actually freed; arena memory is reclaimed by delete_Arena().
+ */
+void
+Arena_free(Arena *arena, void *ptr);
+
+/*
+ * Copy len bytes of str into the arena and null-terminate the copy.
+ */
+char *
+Arena_strndup(Arena *arena, const char *str, size_t len);
+
+/*
+ * Return the arena that AST nodes, types and containers are currently
+ * allocated from, or NULL if there is none.
+ */
+Arena *
+Arena_current(void);
+
+/*
+ * Make arena the current arena and return the previous one, so that a phase
+ * can restore it when it finishes:
+ *     Arena *prev = Arena_enter(phase);
+ *     ...
+ *     Arena_enter(prev);
+ */
+Arena *
+Arena_enter(Arena *arena);
+
+#define arena_malloc(size) Arena_alloc(Arena_current(), (size))
+
+/*
+ * Create an empty arena. If parent is not NULL, the new arena is a sub-arena
+ * that is deleted along with its parent, but it may also be deleted earlier
+ * on its own.
+ */
+Arena *
+new_Arena(Arena *parent);
+
+/*
+ * Free every block allocated from the arena and its sub-arenas at once. If
+ * the arena is current, there is no current arena afterwards.
+ */
+void
+delete_Arena(Arena *arena);
+
+#endif
@@ -4,10 +4,13 @@
 #include <stdio.h>
 
 struct Vector;
+struct Map;
+struct Scope;
 struct SparseVector;
 struct Type;
 struct dstring;
 struct TypeCheckState;
+struct FoldState;
 struct CodeGenState;
 
 #define YYLTYPE YYLTYPE
@@ -24,8 +27,9 @@ typedef struct AST {
     int (*getType)(void *this,
         struct TypeCheckState *state,
         struct Type **typeptr);
+    // Returns the node that replaces this one, which may be itself.
+    struct AST *(*fold)(void *this, struct FoldState *state);
     char *(*codeGen)(void *this, FILE *out, struct CodeGenState *state);
-    void (*delete)(void *this);
     struct YYLTYPE loc;
     struct Type *type;
 } AST;
@@ -45,8 +49,6 @@ new_Argument(AST *ast, unsigned char isRef);
     new_Argument(ast, isRef)
 void
 json_Argument(const struct Argument *arg, FILE *out, int indent);
-void
-delete_Argument(struct Argument *arg);
 
 struct ClassBody {
     struct Vector *fields; // Vector<Field*>
@@ -86,23 +88,142 @@ json_field(const struct Field *field, FILE *out, int indent);
 void
 json_case(const struct Case *c, FILE *out, int indent);
 
+/*
+ * Emit the typedefs for the function and tuple types of the local variables
+ * of the function literal this. seen is as for typedef_FuncType().
+ */
 void
-delete_field(struct Field *field);
+codeGenFuncTypedefs(void *this, struct Map *seen, FILE *out);
 
+/*
+ * Emit the prototype of the C function name that the function literal this
+ * is emitted as. It takes the closure's environment followed by each
+ * argument as a typed parameter.
+ */
 void
-delete_ctor(struct Vector *ctor);
-
+codeGenFuncDecl(void *this,
+    const char *name,
+    FILE *out,
+    const struct CodeGenState *state);
+
+/*
+ * Declare the local variable symbol with type. Returns 1 if it is put in a
+ * heap cell because an escaping closure holds a pointer to it, in which case
+ * its name is #defined to the cell and the caller must #undef it at the end
+ * of its block, otherwise 0.
+ */
+int
+codeGenLocal(const char *symbol,
+    const struct Type *type,
+    FILE *out,
+    const struct CodeGenState *state);
+
+/*
+ * Emit the function literal this as the C function name.
+ */
 void
-delete_case(struct Case *c);
+codeGenFunc(void *this,
+    const char *name,
+    FILE *out,
+    struct CodeGenState *state);
+
+/*
+ * If expr is an operator of an unboxed builtin called with the single
+ * argument in args, emit it as the C operator and return the C expression
+ * for its result. Returns NULL if the call has to go through a closure.
+ */
+char *
+codeGenOperator(AST *expr,
+    struct Vector *args,
+    FILE *out,
+    struct CodeGenState *state);
 
+/*
+ * Fold each AST in asts, replacing the ones that change.
+ */
 void
-delete_AST(AST *this);
-
+fold_vector(struct Vector *asts, struct FoldState *state);
+
+/*
+ * Declare the variables that are declared by the scope symbols of a control
+ * flow statement's block. Returns the ones that are put in cells, for
+ * codeGenStmts(). symbols may be NULL if the block is empty.
+ */
+struct Vector *
+codeGenLocals(struct Scope *symbols, FILE *out, struct CodeGenState *state);
+
+/*
+ * Emit the statements of a block whose variables were declared by
+ * codeGenLocals(), then #undef and delete its cells.
+ */
+void
+codeGenStmts(struct Vector *stmts,
+    struct Vector *cells,
+    FILE *out,
+    struct CodeGenState *state);
+
+/*
+ * Emit the statements of a control flow statement's block, after declaring
+ * the variables that are declared by its scope symbols. symbols may be NULL
+ * if the block is empty.
+ */
 void
-codeGenFuncBody(void *this, FILE *out, struct CodeGenState *state);
+codeGenBlock(struct Scope *symbols,
+    struct Vector *stmts,
+    FILE *out,
+    struct CodeGenState *state);
+
+/*
+ * Emit the statements that evaluate the condition of a control flow
+ * statement and return the C expression for its truth value. Values of the
+ * builtin bool are used directly instead of being cast.
+ */
+char *
+codeGenCondition(AST *cond, FILE *out, struct CodeGenState *state);
+
+/*
+ * If expr is an operator of a builtin called with the single argument in
+ * args and both operands are literals, returns the literal that the call
+ * ast evaluates to. Returns NULL if it has to be evaluated at runtime.
+ */
+AST *
+foldOperator(const AST *ast, AST *expr, struct Vector *args);
+
+/*
+ * If expr is a member called with the single argument in args, like the
+ * operator in a < b, stores the receiver in lhs, the member's name in op and
+ * the argument in rhs and returns 0. Otherwise returns 1.
+ */
+int
+matchOperator(const AST *expr,
+    const struct Vector *args,
+    const AST **lhs,
+    const char **op,
+    const AST **rhs);
+
+/*
+ * Returns the literal that applying the operator op of a builtin to the
+ * literals lhs and rhs evaluates to, with the location and type of ast.
+ * Returns NULL if the operator isn't folded or the result can't be computed
+ * at compile time.
+ */
+AST *
+foldBuiltinOperator(const AST *ast,
+    const char *op,
+    const AST *lhs,
+    const AST *rhs);
+
+/*
+ * Returns the literal that the cast ast of the literal expr to a builtin
+ * evaluates to, or NULL if the cast can't be computed at compile time.
+ */
+AST *
+foldBuiltinCast(const AST *ast, const AST *expr);
 
 #define TypeCheck(root) root->getType(root, NULL, NULL)
 
+#define Fold(root) root->fold(root, NULL)
+
 #define CodeGen(root, out) root->codeGen(root, out, NULL)
 
 #define ASTProgram(loc, stmts) \
@@ -120,6 +241,43 @@ new_ASTDefinition(YYLTYPE loc, struct Vector *vars, AST *expr);
 AST *
 new_ASTVariable(YYLTYPE loc, char *name);
 
+/*
+ * Returns 1 if the function literal ast captures nothing but C globals, so
+ * it is emitted as a plain C function whose closure has no environment.
+ */
+int
+ASTFunc_lifted(const AST *ast, const struct CodeGenState *state);
+
+/*
+ * Returns the interned name of ast if it is a variable, otherwise NULL.
+ */
+const char *
+ASTVariable_name(const AST *ast);
+
+/*
+ * Returns 1 if every read of symbol is folded to the literal it is bound to,
+ * so generated code never reads its variable.
+ */
+int
+ASTVariable_folded(const char *symbol, struct Map *bindings);
+
+/*
+ * If ast is a call of a member with a single argument, stores its operands
+ * as matchOperator() does and returns 0. Otherwise returns 1.
+ */
+int
+ASTCall_operator(const AST *ast,
+    const AST **lhs,
+    const char **op,
+    const AST **rhs);
+
+/*
+ * If ast defines a single variable from an int literal, stores the literal
+ * in val and returns the variable. Otherwise returns NULL.
+ */
+const char *
+ASTDefinition_int(const AST *ast, long long int *val);
+
 #define ASTMember(loc, expr, name) \
     new_ASTMember(loc, expr, name)
 AST *
@@ -179,36 +337,85 @@ new_ASTInit(YYLTYPE loc,
 AST *
 new_ASTTuple(YYLTYPE loc, struct SparseVector *exprs);
 
+/*
+ * Returns the values of ast if it is a tuple literal, otherwise NULL.
+ */
+const struct SparseVector *
+ASTTuple_exprs(const AST *ast);
+
 #define ASTSpread(loc, expr) \
     new_ASTSpread(loc, expr)
 AST *
 new_ASTSpread(YYLTYPE loc, AST *expr);
 
+/*
+ * Emit the statements that evaluate the spread ast and return a
+ * Vector<char*> of the C expression of each of its values. The values of a
+ * spread tuple literal are evaluated into temps of their own, so the tuple
+ * is never built.
+ */
+struct Vector *
+codeGenSpread(AST *ast, FILE *out, struct CodeGenState *state);
+
 #define ASTInt(loc, val) \
     new_ASTInt(loc, val)
 AST *
 new_ASTInt(YYLTYPE loc, long long int val);
 
+/*
+ * If ast is an int literal, stores its value in val and returns 0.
+ * Otherwise returns 1. The same goes for the other literals below.
+ */
+int
+ASTInt_value(const AST *ast, long long int *val);
+
 #define ASTDouble(loc, val) \
     new_ASTDouble(loc, val)
 AST *
 new_ASTDouble(YYLTYPE loc, double val);
 
+int
+ASTDouble_value(const AST *ast, double *val);
+
 #define ASTString(loc, str) \
     new_ASTString(loc, str)
 AST *
 new_ASTString(YYLTYPE loc, struct dstring str);
 
+int
+ASTString_value(const AST *ast, const char **val);
+
 #define ASTBool(loc, val) \
     new_ASTBool(loc, val)
 AST *
 new_ASTBool(YYLTYPE loc, int val);
 
+int
+ASTBool_value(const AST *ast, int *val);
+
 #define ASTArray(loc, type, index) \
     new_ASTArray(loc, type, index)
 AST *
 new_ASTArray(YYLTYPE loc, struct Type *array_type, long long int index);
 
+/*
+ * If ast allocates a new array, stores its length in length and returns 0.
+ * Otherwise returns 1.
+ */
+int
+ASTArray_length(const AST *ast, long long int *length);
+
+/*
+ * Emit the statements that evaluate the array expr and the int index and
+ * check that the index is in the array's bounds, and return the C lvalue of
+ * the element. The check is left out if the index is known to be in bounds:
+ * if it is a constant below the length of the array that a symbol is only
+ * ever bound to, or the counter of a while loop whose bound doesn't exceed
+ * that length.
+ */
+char *
+codeGenIndex(AST *expr, AST *index, FILE *out, struct CodeGenState *state);
+
 #define ASTIf(loc, cond, true, false) \
     new_ASTIf(loc, cond, true, false)
 AST *
@@ -0,0 +1,96 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#define Escapes() new_Escapes()
+
+struct AST;
+struct FuncType;
+
+/*
+ * Escape analysis of the values that code generation allocates. Type checking
+ * records how each symbol is read and where each allocation is made, and code
+ * generation asks which allocations may outlive the C frame that makes them.
+ * Those are put on the heap, and the others on the stack. Symbols are only
+ * told apart by name, so a symbol is treated as escaping if any symbol with
+ * its name does.
+ */
+typedef struct Escapes Escapes;
+
+/*
+ * Record a read of the value of the interned symbol.
+ */
+void
+Escapes_use(Escapes *this, const char *symbol);
+
+/*
+ * Returns 1 if the value of the interned symbol is ever read, otherwise 0.
+ */
+int
+Escapes_read(const Escapes *this, const char *symbol);
+
+/*
+ * Record that a read of the interned symbol was only used to call it.
+ */
+void
+Escapes_call(Escapes *this, const char *symbol);
+
+/*
+ * Record the definition of the interned symbol from the value of expr. local
+ * is 1 if the symbol is a plain local of the C block that allocates the
+ * value, so the symbol goes out of scope along with the value. It is 0 for a
+ * ref parameter, which stores the value through a pointer, or for a symbol
+ * that an enclosing block declares.
+ */
+void
+Escapes_bind(Escapes *this,
+    const struct AST *expr,
+    const char *symbol,
+    int local);
+
+/*
+ * Record an allocation made by the expression ast. inFunction is 1 if it is
+ * made inside a function literal and 0 if it is made in the program's
+ * statements, and nested is 1 if it is made inside a control flow statement.
+ * If ast is a function literal, type is its type, otherwise NULL.
+ */
+void
+Escapes_alloc(Escapes *this,
+    const struct AST *ast,
+    const struct FuncType *type,
+    int inFunction,
+    int nested);
+
+/*
+ * Returns 1 if the value allocated by ast may be used after the C block that
+ * allocates it exits, otherwise 0.
+ *
+ * Allocations in the program's statements outside of control flow statements
+ * live as long as the program. A value assigned through a reference always
+ * escapes. Otherwise, a closure doesn't escape if it is only ever assigned to
+ * locals of the block that creates it, which are only ever called and never
+ * captured.
+ */
+int
+Escapes_escapes(const Escapes *this, const struct AST *ast);
+
+/*
+ * Returns 1 if the interned symbol is captured by a closure that escapes, so
+ * a function that captures it by reference must keep it on the heap.
+ */
+int
+Escapes_captured(const Escapes *this, const char *symbol);
+
+/*
+ * Returns 1 if the interned symbol is captured by any closure, so calling a
+ * closure may assign to it, otherwise 0.
+ */
+int
+Escapes_shared(const Escapes *this, const char *symbol);
+
+/*
+ * Create an empty analysis, allocated from the current arena.
+ */
+Escapes *
+new_Escapes(void);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef INTERN_H
+#define INTERN_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Return the unique interned copy of the first len characters of str. Equal
+ * strings always produce the same pointer, so interned strings can be
+ * compared with == and used directly as pointer-sized Map keys:
+ *     Map_put(map, &name, sizeof(name), value, NULL);
+ * The returned string is null-terminated, must not be modified or freed, and
+ * remains valid until delete_interned() is called.
+ */
+char *
+intern_n(const char *str, size_t len);
+
+/*
+ * Same as intern_n() for a null-terminated string.
+ */
+char *
+intern(const char *str);
+
+/*
+ * Return the length of an interned string without rescanning it.
+ */
+size_t
+intern_len(const char *sym);
+
+/*
+ * Return the hash computed for an interned string when it was interned. It
+ * describes the characters, for hashes that have to be stable across runs.
+ * Maps keyed by interned pointers hash the pointer instead, which doesn't
+ * need to load the string.
+ */
+uint64_t
+intern_hash(const char *sym);
+
+/*
+ * Return the generated C name ("var_<sym>") for an interned identifier. The
+ * name is built on first use and shared by every later call.
+ */
+const char *
+intern_mangled(const char *sym);
+
+/*
+ * JSON_KEY_FUNC for maps keyed by interned strings.
+ */
+void
+json_symbol(const void *key, size_t len, FILE *out);
+
+/*
+ * Free every interned string. All pointers previously returned by the
+ * interner become invalid.
+ */
+void
+delete_interned(void);
+
+#endif
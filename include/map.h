@@ -52,6 +52,12 @@ Map_get(Map *map, const void *key, size_t key_len, void *value);
 int
 Map_remove(Map *map, const void *key, size_t key_len, void *prev);
 
+/*
+ * Return the number of keys in the map.
+ */
+size_t
+Map_size(const Map *map);
+
 void
 delete_Map(Map *map, MAP_DELETE_FUNC delete_value);
 
@@ -0,0 +1,51 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+#include <stddef.h>
+
+struct Type;
+struct FuncType;
+struct Vector;
+struct TypeCheckState;
+
+/*
+ * Dispatch table for the overloads of a function, built when a second
+ * overload is added. Overloads are bucketed by arity and then by the type of
+ * their first argument, so a call only compares against the overloads whose
+ * first argument accepts the given one. Resolutions are cached by the tuple
+ * of canonical argument types.
+ */
+typedef struct OverloadSet OverloadSet;
+
+/*
+ * Append the overload list starting at tail to the overload list starting at
+ * head, in time proportional to the length of tail. head must be the first
+ * overload of its list.
+ */
+void
+AddOverload(struct FuncType *head, struct FuncType *tail);
+
+/*
+ * Find the overloads of head that accept the given arguments. args is a
+ * Vector<struct Argument*> and argTypes holds the type of each argument.
+ * Returns the number of matching overloads, counting at most 2, and points
+ * match at the first one found if there is one.
+ */
+int
+ResolveOverload(struct FuncType *head,
+    const struct Vector *args,
+    const struct Vector *argTypes,
+    const struct TypeCheckState *state,
+    struct FuncType **match);
+
+/*
+ * Find the first overload of the cast operator list head whose return type
+ * is compatible with type. Returns 0 and points match at it if found,
+ * otherwise 1. Results are cached by canonical cast type.
+ */
+int
+ResolveCast(struct FuncType *head,
+    const struct Type *type,
+    const struct TypeCheckState *state,
+    struct FuncType **match);
+
+#endif
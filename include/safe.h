@@ -58,6 +58,18 @@ int SAFE_SIZE;
         NULL)                                                               \
     : SAFE_PTR)
 
+#define safe_tmpfile() (SAFE_PTR = tmpfile(),                                \
+    NULL == SAFE_PTR                                                        \
+    ? (fprintf(stderr, "%s:%d: ", __FILE__, __LINE__),                      \
+        RED(stderr),                                                        \
+        fprintf(stderr, "error: "),                                         \
+        RESET(stderr),                                                      \
+        fprintf(stderr, "in function %s(): ", __func__),                    \
+        perror("tmpfile"),                                                  \
+        exit(EXIT_FAILURE),                                                 \
+        NULL)                                                               \
+    : SAFE_PTR)
+
 #define safe_asprintf(fmt, ...) (                                           \
     SAFE_SIZE = snprintf(NULL, 0, (fmt), __VA_ARGS__),                      \
     SAFE_PTR = malloc(SAFE_SIZE + 1),                                       \
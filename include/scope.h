@@ -0,0 +1,90 @@
+#ifndef SCOPE_H
+#define SCOPE_H
+#include <stddef.h>
+#include <stdio.h>
+#include "map.h"
+
+#define Scope(parent) new_Scope(parent)
+
+/*
+ * A symbol table made of a chain of Maps. Each scope only stores the symbols
+ * it adds or modifies; lookups fall through to the enclosing scopes. Pushing
+ * and popping a scope is O(1) and never copies the enclosing table.
+ */
+typedef struct Scope Scope;
+
+/*
+ * Retrieve a value from the innermost scope that contains the given key,
+ * searching this scope and then each enclosing scope in turn. Returns 0 and
+ * points value at the key's value if found, otherwise returns 1.
+ */
+int
+Scope_get(const Scope *scope, const void *key, size_t key_len, void *value);
+
+#define Scope_contains(scope, key, len) !Scope_get(scope, key, len, NULL)
+
+/*
+ * Retrieve a value only if it was added to this scope itself. Same return
+ * convention as Scope_get.
+ */
+int
+Scope_getLocal(const Scope *scope,
+    const void *key,
+    size_t key_len,
+    void *value);
+
+/*
+ * Returns 1 if the key was added to this scope itself and isn't in any
+ * enclosing scope, so this scope declares it, otherwise 0.
+ */
+int
+Scope_declares(const Scope *scope, const void *key, size_t key_len);
+
+/*
+ * Insert a value into this scope, shadowing any value in an enclosing scope.
+ * Behaves like Map_put on the scope's local map.
+ */
+int
+Scope_put(Scope *scope,
+    const void *key,
+    size_t key_len,
+    void *value,
+    void *prev);
+
+/*
+ * Retrieve a value that is safe to modify in this scope. If the key is only
+ * present in an enclosing scope, its value is copied with copy_value and
+ * inserted into this scope first, so the enclosing scope is left untouched.
+ * Returns 1 if the key doesn't exist in any scope, otherwise 0.
+ */
+int
+Scope_own(Scope *scope,
+    const void *key,
+    size_t key_len,
+    MAP_COPY_FUNC copy_value,
+    void *value);
+
+/*
+ * Iterate over the symbols added to this scope, not including those from
+ * enclosing scopes.
+ */
+Iterator *
+Scope_iterator(Scope *scope);
+
+void
+json_Scope(const Scope *scope,
+    JSON_KEY_FUNC json_key,
+    JSON_VALUE_FUNC json_value,
+    FILE *out,
+    int indent);
+
+Scope *
+new_Scope(Scope *parent);
+
+/*
+ * Delete this scope and its own values. Enclosing scopes are not affected.
+ */
+void
+delete_Scope(Scope *scope, MAP_DELETE_FUNC delete_value);
+
+#endif
@@ -7,6 +7,14 @@
 #define ull unsigned long long int
 
 typedef struct SparseVector SparseVector;
+
+/*
+ * A run of count consecutive copies of element.
+ */
+typedef struct SparseSpan {
+    void *element;
+    ull count;
+} SparseSpan;
 typedef void (*SVEC_DELETE_FUNC)(void *);
 typedef void *(*SVEC_COPY_FUNC)(const void *);
 typedef int (*SVEC_COMPARE_FUNC)(const void *, const void *, const void *data);
@@ -20,9 +28,34 @@ SparseVector_get(const SparseVector *this,
     void *element_ptr,
     ull *count_ptr);
 
+/*
+ * Replace the element of the run at position index, keeping its count.
+ */
+void
+SparseVector_set(SparseVector *this, size_t index, void *element);
+
+/*
+ * Point element_ptr at the element with the given logical index, counting
+ * every copy in each run. Runs are found by binary search over a cumulative
+ * count index that is extended lazily after appends.
+ */
 int
 SparseVector_at(const SparseVector *this, ull index, void *element_ptr);
 
+/*
+ * Return the position of the run containing the given logical index, so
+ * that a range of logical indices can be iterated starting from its span.
+ */
+size_t
+SparseVector_find(const SparseVector *this, ull index);
+
+/*
+ * Return the vector's runs in order, SparseVector_size() of them. The array
+ * is owned by the vector and is invalidated by any later modification.
+ */
+const SparseSpan *
+SparseVector_spans(const SparseVector *this);
+
 size_t
 SparseVector_size(const SparseVector *this);
 
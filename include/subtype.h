@@ -0,0 +1,62 @@
+#ifndef SUBTYPE_H
+#define SUBTYPE_H
+#include <stddef.h>
+#include <stdio.h>
+
+#define SubtypeMatrix() new_SubtypeMatrix()
+
+struct ClassType;
+struct Vector;
+struct TypeCheckState;
+
+/*
+ * Memoized subtype relation between verified classes, stored as a dense
+ * matrix with two bits per pair of class IDs. Pairs are only compared
+ * structurally the first time they are queried, so type checking never pays
+ * for pairs of classes it doesn't compare.
+ */
+typedef struct SubtypeMatrix SubtypeMatrix;
+
+/*
+ * Returns 0 if class1 has every field of class2 with a compatible type,
+ * otherwise 1. The answer is computed by compare_ClassType() on the first
+ * query for a pair and remembered afterwards. A pair that is queried again
+ * while it is still being computed is assumed to be a subtype, so recursive
+ * classes are compared coinductively. Builtin classes are only compatible
+ * with themselves.
+ */
+int
+SubtypeMatrix_compare(SubtypeMatrix *this,
+    const struct ClassType *class1,
+    const struct ClassType *class2,
+    const struct TypeCheckState *state);
+
+/*
+ * Set class->subtypes, unless it is already set, to the bitset of the IDs of
+ * the classes in classes that are subtypes of class. ID i is bit i % 64 of
+ * word i / 64. The bitset is allocated from the matrix's arena.
+ */
+void
+SubtypeMatrix_subtypes(SubtypeMatrix *this,
+    struct ClassType *class,
+    const struct Vector *classes,
+    const struct TypeCheckState *state);
+
+/*
+ * Print every class in classes with the classes it is known to be a subtype
+ * of. Pairs that were never queried are omitted.
+ */
+void
+json_SubtypeMatrix(const SubtypeMatrix *this,
+    const struct Vector *classes,
+    FILE *out,
+    int indent);
+
+/*
+ * Create an empty matrix. Its storage is allocated from the current arena
+ * and grows as classes with higher IDs are queried.
+ */
+SubtypeMatrix *
+new_SubtypeMatrix(void);
+
+#endif
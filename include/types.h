@@ -2,11 +2,14 @@
 #define TYPES_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include "ast.h"
 
 struct Vector;
 struct SparseVector;
 struct Map;
+struct Scope;
+struct Escapes;
 
 typedef enum Types {
     TYPE_FUNC,
@@ -37,11 +40,9 @@ struct Type {
     int (*verify)(void *type, const struct TypeCheckState *state, char **msg);
     char *(*toString)(const void *this);
     char *(*codeGen)(const void *this, const char *name);
-    void (*delete)(void *this);
     Types type;
     Qualifiers qualifiers; // Vector<Qualifiers*>
     unsigned char init : 1;
-    unsigned char isCopy : 1;
     unsigned char isRef : 1;
     YYLTYPE loc;
 };
@@ -51,9 +52,19 @@ struct FuncType {
     AST *ast;
     struct Vector *generics; // Vector<char*>
     struct Vector *args;     // Vector<Type*>
-    struct Map *env;         // Map<Type*, NULL>
+    struct Map *env;         // Map<interned char*, NULL>
     Type *ret_type;
     struct FuncType *next;   // NULLable
+    // Only maintained on the first overload of a list:
+    struct FuncType *last;   // Last overload of the list
+    size_t nOverloads;       // Length of the list
+    // NULL until a second overload is added. Shared by copies of the list.
+    struct OverloadSet *overloads;
+};
+
+struct ClassField {
+    char *name; // Interned
+    Type *type;
 };
 
 struct ClassType {
@@ -64,7 +75,19 @@ struct ClassType {
     struct Vector *fields;   // Vector<Field*>
     struct Vector *ctors;    // Vector<Vector<Type*>>
     // NULL until verify() is executed:
-    struct Map *fieldTypes;  // Map<char*, Type*>
+    struct Map *fieldTypes;  // Map<interned char*, Type*>
+    // Set by index_ClassType() once fieldTypes is complete:
+    uint64_t fieldMask;      // Bloom filter over the field names
+    struct ClassField *fieldList; // fieldTypes sorted by name pointer
+    size_t nFields;
+    // 0 until verify() is executed, then the class's 1-based position in
+    // TypeCheckState.classes. Builtins have the IDs 1 to NUM_BUILTINS.
+    size_t id;
+    // NULL unless instances are stored unboxed as this C type
+    const char *ctype;
+    // NULL unless a type case tests for this class, then set after type
+    // checking by SubtypeMatrix_subtypes().
+    uint64_t *subtypes;
 };
 
 struct ObjectType {
@@ -112,18 +135,31 @@ enum BUILTIN_TYPE {
 #define NUM_BUILTINS 4
 
 typedef struct TypeCheckState {
-    struct Map *symbols;    // Map<char*, Type*>
+    struct Scope *symbols;  // Scope<interned char*, Type*>
     // Used inside control flow statements to add newly defined symbols to
     // the outer scope if they are defined in all code paths. Defaults to
     // NULL and allocation and destruction must be handled by the control
     // flow AST node.
-    struct Map *newInitSymbols; // Map<char*, NULL>
-    struct Map *newSymbols;     // Map<char*, NULL>
-    struct Map *usedSymbols;    // Map<char*, NULL>
+    struct Map *newInitSymbols; // Map<interned char*, NULL>
+    struct Map *newSymbols;     // Map<interned char*, NULL>
+    struct Map *usedSymbols;    // Map<interned char*, NULL>
+    // Symbols assigned to by the statements being type checked in the body
+    // of the innermost while loop, or NULL outside of loops.
+    struct Map *assigned;       // Map<interned char*, NULL>
     struct Vector *classes;     // Vector<const struct ClassType*>
     struct Vector *functions;   // Vector<const struct FuncType*>
+    // Scopes of the blocks of control flow statements.
+    struct Vector *scopes;      // Vector<struct Scope*>
+    // Classes that the type cases of switches test for.
+    struct Vector *typeCases;   // Vector<struct ClassType*>
     const struct ClassType *builtins[NUM_BUILTINS];
-    struct Map *compare; // Map<Type**, Map<Type**, int>>
+    struct SubtypeMatrix *subtypes;
+    // The value each symbol is bound to, or NULL if the symbol is bound more
+    // than once or by reference. See BindSymbol().
+    struct Map *bindings;       // Map<interned char*, AST*>
+    struct Escapes *escapes;
+    // Scope of the innermost function's statements, or of the program's.
+    struct Scope *frame;
     // NULL if not in function, otherwise return type of current function
     Type *funcType;
     // NULL initially, gets set by return statements. Used to tell if there are
@@ -132,11 +168,33 @@ typedef struct TypeCheckState {
     Type *retType;
 } TypeCheckState;
 
+typedef struct FoldState {
+    struct Map *bindings;     // See TypeCheckState
+} FoldState;
+
 typedef struct CodeGenState {
     int indent;
     unsigned int tempCount;
     unsigned int funcCount;
     struct Map *funcIDs;      // Map<const struct FuncType*, char*>
+    struct Map *bindings;     // See TypeCheckState
+    const struct Escapes *escapes;
+    // Program symbols that functions read as C globals instead of capturing.
+    struct Map *globals;      // Map<interned char*, NULL>
+    // Functions whose closures the emitted code creates.
+    struct Map *reached;      // Map<const struct FuncType*, NULL>
+    // Classes have the IDs 1 to nclasses.
+    size_t nclasses;
+    // Types of the tuples and closures built in temps, which may not be a
+    // symbol's type.
+    struct Vector *temps;     // Vector<const Type*>
+    // Exclusive upper bounds of the counters of the while loops whose bodies
+    // are being generated. In the body, a counter is in [0, bound).
+    struct Map *bounds;       // Map<interned char*, long long*>
+    // The statement generated before the current one in its block, or NULL.
+    const AST *prev;
+    // The statement being generated, whose own value is discarded.
+    const AST *stmt;
 } CodeGenState;
 
 void
@@ -145,44 +203,162 @@ json_type(const Type *type, FILE *out, int indent);
 void
 json_qualifier(Qualifiers value, FILE *out, int indent);
 
-void
-delete_type(Type *type);
-
-void
-delete_ClassType(struct ClassType *this);
-
 int
 compare_ClassType(const struct ClassType *this,
     const struct ClassType *other,
     const struct TypeCheckState *state);
 
+/*
+ * Build the field fingerprint and sorted field list of a class from its
+ * fieldTypes. Must be called again if fieldTypes changes afterwards.
+ */
+void
+index_ClassType(struct ClassType *this);
+
 Type *
 copy_type(Type *type);
 
+/*
+ * Returns a copy of type with its init flag set, leaving type unchanged.
+ */
+Type *
+copy_type_init(Type *type);
+
+/*
+ * Returns the shared canonical instance of a verified object or none type,
+ * creating it on first use, or NULL if the type has no canonical form.
+ * Canonical instances are immutable and copy_type() returns them unchanged,
+ * so equal types can be compared by pointer. They are allocated from the
+ * current arena.
+ */
+Type *
+canonical_type(const Type *type);
+
+/*
+ * Returns the class of a builtin. The builtin is a flag, not an index into
+ * state->builtins.
+ */
+const struct ClassType *
+BuiltinClass(enum BUILTIN_TYPE builtin, const TypeCheckState *state);
+
+/*
+ * Returns the canonical initialized instance of a builtin class.
+ */
+Type *
+BuiltinType(enum BUILTIN_TYPE builtin, const TypeCheckState *state);
+
+/*
+ * Returns the class of type if its values are stored unboxed as the class's
+ * ctype, otherwise NULL. Unboxed values are only boxed when they are passed
+ * to or returned from a closure.
+ */
+const struct ClassType *
+unboxed_class(const Type *type);
+
+/*
+ * Forget every canonical instance. Must be called before the arena they were
+ * allocated from is deleted.
+ */
+void
+reset_canonical_types(void);
+
 int
 TypeCompare(const Type *type1, const Type *type2, const TypeCheckState *state);
 
-void
-AddComparison(const struct ClassType *type, TypeCheckState *state);
+/*
+ * Mark an existing symbol as initialized in the given scope, copying it out
+ * of an enclosing scope if needed. Returns 1 if the symbol doesn't exist,
+ * otherwise 0.
+ */
+int
+InitSymbol(struct Scope *symbols, const void *symbol, size_t len);
 
 /*
- * Add a symbol and its type to the state's symbol table. If there is a name
- * conflict, returns 1. Otherwise, returns 0.
+ * Add an interned symbol and its type to the state's symbol table. If there
+ * is a name conflict, returns 1. Otherwise, returns 0.
  * If the symbol already exists, is a function, and the added type is also a
  * function, combines the two functions into one overloaded symbol. This
  * means f(int) and f(bool) can both refer to unique functions under the
- * same symbol "f". In this case, the passed type is freed by the AddSymbol
- * function.
+ * same symbol "f". In this case, the passed type is appended to the
+ * existing overload chain.
+ * A symbol inherited from an enclosing scope is copied into the given scope
+ * before it is modified.
  */
 int
-AddSymbol(struct Map *symbols,
+AddSymbol(struct Scope *symbols,
     const char *symbol,
-    size_t len,
     Type *type,
     unsigned char makeCopy,
     const TypeCheckState *state,
     char **msg);
 
+/*
+ * Record an assignment to an interned symbol. value is the expression being
+ * assigned, the function literal for a parameter, or NULL if it is assigned
+ * through a reference. A call through a symbol that is only ever bound once,
+ * to a function literal, can be emitted as a direct call to that function,
+ * and a symbol that is only ever bound once can be captured by value.
+ * Inside a while loop, the symbol is also added to state->assigned.
+ */
+void
+BindSymbol(const TypeCheckState *state, const char *symbol, AST *value);
+
+/*
+ * Emit the C function and closure typedefs that FuncType.codeGen() spells
+ * each overload of this with, after those of any function types in them. If
+ * the overloads have more than one signature, the list is spelled as a
+ * struct with a closure fN for the Nth signature, which is emitted after
+ * them. seen is a Map<char[], NULL> of the typedefs already emitted.
+ */
+void
+typedef_FuncType(const struct FuncType *this, struct Map *seen, FILE *out);
+
+/*
+ * Emit the C struct typedef that TupleType.codeGen() spells this with,
+ * after those of its element types. Each run of elements is a field fN, an
+ * inline array if it has more than one element. seen is as for
+ * typedef_FuncType().
+ */
+void
+typedef_TupleType(const struct TupleType *this, struct Map *seen, FILE *out);
+
+/*
+ * Emit the typedefs that Type.codeGen() spells type with, if it is a
+ * function or tuple type. seen is as for typedef_FuncType().
+ */
+void
+typedef_Type(const Type *type, struct Map *seen, FILE *out);
+
+/*
+ * Returns the name of type in the C typedefs, ignoring whether it is a
+ * reference.
+ */
+char *
+mangle_Type(const Type *type);
+
+/*
+ * Returns the C expression for the element at index of value, a tuple of
+ * type this, as a direct access to the field of its run.
+ */
+char *
+TupleType_field(const struct TupleType *this,
+    const char *value,
+    unsigned long long index);
+
+/*
+ * Returns 1 if type is a list of overloads with more than one signature, so
+ * its C value is a struct of closures, otherwise 0.
+ */
+int
+IsOverloaded(const Type *type);
+
+/*
+ * Returns the field of the C struct for the overloads head that holds the
+ * closure with func's signature.
+ */
+size_t
+FindOverload(const struct FuncType *head, const struct FuncType *func);
+
 #define FuncType(loc, gen, args, ret) \
     new_FuncType(loc, gen, args, ret)
 Type *
@@ -39,5 +39,16 @@ void
 print_code_error_func(FILE *out, struct YYLTYPE loc, const char *msg, ...);
 void
 strident(const char *str, char *buf);
+/*
+ * Print str as a C string literal, escaping the characters that can't appear
+ * in one as they are.
+ */
+void
+fprint_c_string(FILE *out, const char *str);
+/*
+ * Append the contents of the temporary file tmp to out, and close tmp.
+ */
+void
+copy_file(FILE *tmp, FILE *out);
 
 #endif
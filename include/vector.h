@@ -3,9 +3,14 @@
 
 #include <stddef.h>
 #include <stdio.h>
+#include "arena.h"
 
 #define Vector() new_Vector(0)
 
+// Number of elements stored inside the vector itself before its first
+// separate allocation.
+#define VECTOR_INLINE_SIZE 4
+
 typedef struct Vector Vector;
 typedef void (*VEC_DELETE_FUNC)(void *);
 typedef void *(*VEC_COPY_FUNC)(const void *);
@@ -27,6 +32,13 @@ Vector_append(Vector *this, void *element);
 void *
 Vector_get(const Vector *this, size_t index);
 
+/*
+ * If index is within the bounds of the vector, replaces the element at that
+ * index. Otherwise prints an error and exits the program.
+ */
+void
+Vector_set(Vector *this, size_t index, void *element);
+
 /*
  * Returns the number of elements in the vector.
  */
@@ -59,4 +71,111 @@ copy_Vector(const Vector *vec, VEC_COPY_FUNC copy_value);
 void
 delete_Vector(Vector *this, VEC_DELETE_FUNC delete_value);
 
+struct Arena;
+
+/*
+ * Double the capacity of a vector's storage, moving its elements out of the
+ * inline buffer if needed, and return the new storage. Shared by Vector and
+ * the typed vectors declared with DECLARE_VECTOR().
+ */
+void *
+vector_grow(void *items,
+    const void *inline_items,
+    size_t *capacity,
+    size_t elem_size,
+    struct Arena *arena);
+
+/*
+ * Print an internal compiler error for an out of bounds vector index and
+ * exit.
+ */
+void
+vector_index_error(const char *name, size_t index, size_t size);
+
+/*
+ * Declare Name, a vector of T with the same growth and inline storage as
+ * Vector, and static inline functions to use it:
+ *     Name *new_Name(size_t size)
+ *     void init_Name(Name *this, struct Arena *arena, size_t size)
+ *     Name *Name_append(Name *this, T element)
+ *     T Name_get(const Name *this, size_t index)
+ *     size_t Name_size(const Name *this)
+ *     void clear_Name(Name *this)
+ *     void delete_Name(Name *this)
+ * Elements are stored unboxed and the items array may be indexed directly.
+ * init_Name() and clear_Name() set up and release a Name embedded in another
+ * struct. A Name must not be copied by value, since items may point into
+ * the struct itself.
+ */
+#define DECLARE_VECTOR(Name, T)                                             \
+    typedef struct Name {                                                   \
+        T *items;                                                           \
+        size_t capacity;                                                    \
+        size_t size;                                                        \
+        struct Arena *arena;                                                \
+        T inline_items[VECTOR_INLINE_SIZE];                                 \
+    } Name;                                                                 \
+                                                                            \
+    static inline void                                                      \
+    init_##Name(Name *this, struct Arena *arena, size_t size) {             \
+        this->items = size > VECTOR_INLINE_SIZE                             \
+            ? Arena_alloc(arena, size * sizeof(T))                          \
+            : this->inline_items;                                           \
+        this->capacity = size > VECTOR_INLINE_SIZE                          \
+            ? size                                                          \
+            : VECTOR_INLINE_SIZE;                                           \
+        this->size = 0;                                                     \
+        this->arena = arena;                                                \
+    }                                                                       \
+                                                                            \
+    static inline Name *                                                    \
+    new_##Name(size_t size) {                                               \
+        struct Arena *arena = Arena_current();                              \
+        Name *this = Arena_alloc(arena, sizeof(*this));                     \
+        init_##Name(this, arena, size);                                     \
+        return this;                                                        \
+    }                                                                       \
+                                                                            \
+    static inline Name *                                                    \
+    Name##_append(Name *this, T element) {                                  \
+        if (this->size == this->capacity) {                                 \
+            this->items = vector_grow(this->items,                          \
+                this->inline_items,                                         \
+                &this->capacity,                                            \
+                sizeof(T),                                                  \
+                this->arena);                                               \
+        }                                                                   \
+        this->items[this->size++] = element;                                \
+        return this;                                                        \
+    }                                                                       \
+                                                                            \
+    static inline T                                                         \
+    Name##_get(const Name *this, size_t index) {                            \
+        if (index >= this->size) {                                          \
+            vector_index_error(#Name, index, this->size);                   \
+        }                                                                   \
+        return this->items[index];                                          \
+    }                                                                       \
+                                                                            \
+    static inline size_t                                                    \
+    Name##_size(const Name *this) {                                         \
+        return this->size;                                                  \
+    }                                                                       \
+                                                                            \
+    static inline void                                                      \
+    clear_##Name(Name *this) {                                              \
+        if (this->items != this->inline_items) {                            \
+            Arena_free(this->arena, this->items);                           \
+        }                                                                   \
+        this->items = this->inline_items;                                   \
+        this->capacity = VECTOR_INLINE_SIZE;                                \
+        this->size = 0;                                                     \
+    }                                                                       \
+                                                                            \
+    static inline void                                                      \
+    delete_##Name(Name *this) {                                             \
+        clear_##Name(this);                                                 \
+        Arena_free(this->arena, this);                                      \
+    }
+
 #endif
@@ -0,0 +1,46 @@
+#include "tlangrt.h"
+
+array
+new_array(size_t length, size_t size) {
+    array ret;
+    if (NULL == (ret = malloc(sizeof(*ret)))) {
+        ERROR("malloc");
+    }
+    ret->length = ret->capacity = length;
+    ret->data = NULL;
+    if (0 < length && NULL == (ret->data = calloc(length, size))) {
+        ERROR("calloc");
+    }
+    return ret;
+}
+
+void
+array_resize(array this, size_t length, size_t size) {
+    if (this->capacity < length) {
+        size_t capacity = this->capacity < 8
+            ? 8
+            : this->capacity;
+        while (capacity < length) {
+            capacity *= 2;
+        }
+        if (NULL == (this->data = realloc(this->data, capacity * size))) {
+            ERROR("realloc");
+        }
+        this->capacity = capacity;
+    }
+    if (this->length < length) {
+        memset((char *)this->data + this->length * size,
+            0,
+            (length - this->length) * size);
+    }
+    this->length = length;
+}
+
+void
+array_index_error(int64_t index, size_t length) {
+    fprintf(stderr,
+        "array index %" PRId64 " is out of bounds for length %zu\n",
+        index,
+        length);
+    exit(EXIT_FAILURE);
+}
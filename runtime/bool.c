@@ -0,0 +1,27 @@
+#include "tlangrt.h"
+
+int64_t
+class_bool_cast_class_int_direct(unsigned char val) {
+    return (int64_t)val;
+}
+
+unsigned char
+class_bool_cast_class_bool_direct(unsigned char val) {
+    return (unsigned char)val;
+}
+
+double
+class_bool_cast_class_double_direct(unsigned char val) {
+    return (double)val;
+}
+
+class_string
+class_bool_cast_class_string_direct(unsigned char val) {
+    size_t size = snprintf(NULL, 0, "%d", val);
+    char *str;
+    if (NULL == (str = malloc(size + 1))) {
+        ERROR("malloc");
+    }
+    sprintf(str, "%d", val);
+    return builtin_string(str);
+}
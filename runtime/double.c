@@ -0,0 +1,27 @@
+#include "tlangrt.h"
+
+int64_t
+class_double_cast_class_int_direct(double val) {
+    return (int64_t)val;
+}
+
+unsigned char
+class_double_cast_class_bool_direct(double val) {
+    return (unsigned char)val;
+}
+
+double
+class_double_cast_class_double_direct(double val) {
+    return (double)val;
+}
+
+class_string
+class_double_cast_class_string_direct(double val) {
+    size_t size = snprintf(NULL, 0, "%f", val);
+    char *str;
+    if (NULL == (str = malloc(size + 1))) {
+        ERROR("malloc");
+    }
+    sprintf(str, "%f", val);
+    return builtin_string(str);
+}
@@ -0,0 +1,27 @@
+#include "tlangrt.h"
+
+int64_t
+class_int_cast_class_int_direct(int64_t val) {
+    return (int64_t)val;
+}
+
+unsigned char
+class_int_cast_class_bool_direct(int64_t val) {
+    return (unsigned char)val;
+}
+
+double
+class_int_cast_class_double_direct(int64_t val) {
+    return (double)val;
+}
+
+class_string
+class_int_cast_class_string_direct(int64_t val) {
+    size_t size = snprintf(NULL, 0, "%" PRId64, val);
+    char *str;
+    if (NULL == (str = malloc(size + 1))) {
+        ERROR("malloc");
+    }
+    sprintf(str, "%" PRId64, val);
+    return builtin_string(str);
+}
@@ -0,0 +1,112 @@
+#include "tlangrt.h"
+
+class_string
+class_string_field_2B3D_direct(class_string this, class_string other) {
+    size_t size = strlen(this->val);
+    size_t len = size + strlen(other->val) + 1;
+    if (NULL == (this->val = realloc(this->val, len))) {
+        ERROR("realloc");
+    }
+    strcpy(this->val + size, other->val);
+    return this;
+}
+
+class_string
+class_string_field_2B_direct(class_string this, class_string other) {
+    size_t size1 = strlen(this->val),
+           size2 = strlen(other->val);
+    char *val;
+    if (NULL == (val = malloc(size1 + size2 + 1))) {
+        ERROR("malloc");
+    }
+    strcpy(val, this->val);
+    strcpy(val + size1, other->val);
+    return builtin_string(val);
+}
+
+unsigned char
+class_string_field_3D3D_direct(class_string this, class_string other) {
+    return 0 == strcmp(this->val, other->val);
+}
+
+unsigned char
+class_string_field_213D_direct(class_string this, class_string other) {
+    return 0 != strcmp(this->val, other->val);
+}
+
+uint64_t
+hash_string(const char *val, uint64_t seed) {
+    // 64-bit FNV-1a from a seeded basis, mixed so the top bits depend on
+    // every byte.
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (; '\0' != *val; val++) {
+        h ^= (unsigned char)*val;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+class_string
+class_string_cast_class_string_direct(class_string this) {
+    return builtin_string(this->val);
+}
+
+// Methods for the vtable, which take the receiver as their env.
+static class_string
+class_string_field_2B(void *env, class_string other) {
+    return class_string_field_2B_direct(env, other);
+}
+
+static class_string
+class_string_field_2B3D(void *env, class_string other) {
+    return class_string_field_2B3D_direct(env, other);
+}
+
+static unsigned char
+class_string_field_3D3D(void *env, class_string other) {
+    return class_string_field_3D3D_direct(env, other);
+}
+
+static unsigned char
+class_string_field_213D(void *env, class_string other) {
+    return class_string_field_213D_direct(env, other);
+}
+
+static class_string
+class_string_cast_class_string(void *env) {
+    return class_string_cast_class_string_direct(env);
+}
+
+const struct vtable_string vtable_string = {
+    4,
+    class_string_field_2B,
+    class_string_field_2B3D,
+    class_string_field_3D3D,
+    class_string_field_213D,
+    class_string_cast_class_string
+};
+
+class_string
+builtin_string(char *val) {
+    class_string ret;
+    if (NULL == (ret = malloc(sizeof(*ret)))) {
+        ERROR("malloc");
+    }
+    *ret = (struct class_string){
+        &vtable_string,
+        val
+    };
+    return ret;
+}
+
+class_string
+new_string(void) {
+    char *val;
+    if (NULL == (val = calloc(1, 1))) {
+        ERROR("calloc");
+    }
+    return builtin_string(val);
+}
@@ -0,0 +1,157 @@
+#ifndef TLANGRT_H
+#define TLANGRT_H
+
+/*
+ * Runtime library of the builtin classes. The C that tlang2 generates
+ * includes this header and is linked against libtlangrt, so the runtime is
+ * compiled once instead of with every program. Its definitions have to match
+ * the builtins table in src/ast/program.c.
+ */
+
+// Generated code calls strdup(), which strict ISO C doesn't declare.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define ERROR(msg) { \
+    perror(msg); \
+    exit(EXIT_FAILURE); \
+}
+
+/*
+ * Methods of a string live in one shared vtable, which takes the receiver as
+ * the closure's env. Like every vtable it starts with the ID of its class,
+ * which the type cases of switches test. The builtins int, bool, double and
+ * string have the IDs 1 to 4.
+ */
+struct vtable_string {
+    unsigned int id;
+    struct class_string *(*field_2B)(void *env, struct class_string *other);
+    struct class_string *(*field_2B3D)(void *env, struct class_string *other);
+    unsigned char (*field_3D3D)(void *env, struct class_string *other);
+    unsigned char (*field_213D)(void *env, struct class_string *other);
+    struct class_string *(*cast_class_string)(void *env);
+};
+
+typedef struct class_string {
+    const struct vtable_string *vtable;
+    char *val;
+} *class_string;
+
+extern const struct vtable_string vtable_string;
+
+/*
+ * An array is one contiguous buffer of the C values of its elements, so the
+ * elements of int, bool and double arrays are stored unboxed. The generated
+ * code indexes data directly, cast to a pointer to the element's C type.
+ */
+typedef struct array {
+    size_t length;
+    size_t capacity;
+    void *data;
+} *array;
+
+/*
+ * Allocate an array of length zeroed elements that are size bytes each.
+ */
+array
+new_array(size_t length, size_t size);
+
+/*
+ * Change the length of an array whose elements are size bytes each. New
+ * elements are zeroed, and the capacity grows geometrically so that
+ * growing an array one element at a time takes amortized constant time.
+ */
+void
+array_resize(array this, size_t length, size_t size);
+
+/*
+ * Report an index outside of an array's bounds and exit.
+ */
+void
+array_index_error(int64_t index, size_t length);
+
+/*
+ * Allocate a string holding val.
+ */
+class_string
+builtin_string(char *val);
+
+/*
+ * Allocate an empty string, for the default constructor of string.
+ */
+class_string
+new_string(void);
+
+/*
+ * Casts between the builtins. Builtins have no subclasses, so the generated
+ * code calls these directly instead of through a vtable.
+ */
+int64_t
+class_int_cast_class_int_direct(int64_t val);
+
+unsigned char
+class_int_cast_class_bool_direct(int64_t val);
+
+double
+class_int_cast_class_double_direct(int64_t val);
+
+class_string
+class_int_cast_class_string_direct(int64_t val);
+
+int64_t
+class_bool_cast_class_int_direct(unsigned char val);
+
+unsigned char
+class_bool_cast_class_bool_direct(unsigned char val);
+
+double
+class_bool_cast_class_double_direct(unsigned char val);
+
+class_string
+class_bool_cast_class_string_direct(unsigned char val);
+
+int64_t
+class_double_cast_class_int_direct(double val);
+
+unsigned char
+class_double_cast_class_bool_direct(double val);
+
+double
+class_double_cast_class_double_direct(double val);
+
+class_string
+class_double_cast_class_string_direct(double val);
+
+class_string
+class_string_cast_class_string_direct(class_string this);
+
+/*
+ * Operators of string, called directly by the generated code.
+ */
+class_string
+class_string_field_2B_direct(class_string this, class_string other);
+
+class_string
+class_string_field_2B3D_direct(class_string this, class_string other);
+
+unsigned char
+class_string_field_3D3D_direct(class_string this, class_string other);
+
+unsigned char
+class_string_field_213D_direct(class_string this, class_string other);
+
+/*
+ * Hash of a string's value. Switches over string literals dispatch on its
+ * top bits, with a seed that src/ast/switch.c picks so the case strings
+ * don't collide, so the two have to hash the same way.
+ */
+uint64_t
+hash_string(const char *val, uint64_t seed);
+
+#endif
@@ -0,0 +1,164 @@
+#include "arena.h"
+#include "safe.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CHUNK_SIZE 65536
+#define ALIGNMENT _Alignof(max_align_t)
+#define ALIGN(size) (((size) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+struct Chunk {
+    struct Chunk *next;
+    size_t used;
+    size_t size;
+    _Alignas(max_align_t) char data[];
+};
+
+struct Arena {
+    struct Chunk *chunks; // Most recent chunk first
+    void *last;           // Most recent allocation, NULL if it can't grow
+    Arena *parent;
+    Arena *children;
+    Arena *sibling;
+};
+
+static Arena *current = NULL;
+
+static struct Chunk *
+new_chunk(size_t size) {
+    if (size < CHUNK_SIZE) {
+        size = CHUNK_SIZE;
+    }
+    struct Chunk *chunk = safe_malloc(sizeof(*chunk) + size);
+    chunk->next = NULL;
+    chunk->used = 0;
+    chunk->size = size;
+    return chunk;
+}
+
+void *
+Arena_alloc(Arena *arena, size_t size) {
+    if (NULL == arena) {
+        return safe_malloc(size);
+    }
+    size = ALIGN(size);
+    struct Chunk *chunk = arena->chunks;
+    if (NULL == chunk || chunk->size - chunk->used < size) {
+        if (size > CHUNK_SIZE / 4 && NULL != chunk) {
+            // Give large blocks their own chunk behind the current one so
+            // the space left in the current chunk isn't wasted.
+            struct Chunk *big = new_chunk(size);
+            big->used = size;
+            big->next = chunk->next;
+            chunk->next = big;
+            arena->last = NULL;
+            return big->data;
+        }
+        chunk = new_chunk(size);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+void *
+Arena_realloc(Arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (NULL == arena) {
+        return safe_realloc(ptr, new_size);
+    }
+    if (NULL != ptr && ptr == arena->last) {
+        struct Chunk *chunk = arena->chunks;
+        size_t start = (char *)ptr - chunk->data;
+        if (ALIGN(new_size) <= chunk->size - start) {
+            chunk->used = start + ALIGN(new_size);
+            return ptr;
+        }
+    }
+    void *new_ptr = Arena_alloc(arena, new_size);
+    if (NULL != ptr) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return new_ptr;
+}
+
+void
+Arena_free(Arena *arena, void *ptr) {
+    if (NULL == arena) {
+        free(ptr);
+    }
+}
+
+char *
+Arena_strndup(Arena *arena, const char *str, size_t len) {
+    char *copy = Arena_alloc(arena, len + 1);
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+Arena *
+Arena_current(void) {
+    return current;
+}
+
+Arena *
+Arena_enter(Arena *arena) {
+    Arena *prev = current;
+    current = arena;
+    return prev;
+}
+
+Arena *
+new_Arena(Arena *parent) {
+    Arena *arena = safe_malloc(sizeof(*arena));
+    *arena = (Arena){
+        NULL,
+        NULL,
+        parent,
+        NULL,
+        NULL
+    };
+    if (NULL != parent) {
+        arena->sibling = parent->children;
+        parent->children = arena;
+    }
+    return arena;
+}
+
+static void
+release(Arena *arena) {
+    while (NULL != arena->children) {
+        Arena *child = arena->children;
+        arena->children = child->sibling;
+        release(child);
+    }
+    struct Chunk *chunk = arena->chunks;
+    while (NULL != chunk) {
+        struct Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void
+delete_Arena(Arena *arena) {
+    for (Arena *a = current; NULL != a; a = a->parent) {
+        if (a == arena) {
+            current = NULL;
+            break;
+        }
+    }
+    if (NULL != arena->parent) {
+        Arena **link = &arena->parent->children;
+        while (*link != arena) {
+            link = &(*link)->sibling;
+        }
+        *link = arena->sibling;
+    }
+    release(arena);
+}
@@ -1,7 +1,14 @@
 #include <ast.h>
 #include "ast.h"
+#include <stdlib.h>
 #include "json.h"
 #include "parser.h"
+#include "arena.h"
+#include "vector.h"
+#include "map.h"
+#include "scope.h"
+#include "types.h"
+#include "intern.h"
 
 typedef struct ASTData ASTData;
 
@@ -9,7 +16,7 @@ struct Case *
 new_TypeCase(char *name, struct Type *type, struct Vector *stmts) {
     struct Case *ret;
 
-    ret = safe_malloc(sizeof(*ret));
+    ret = arena_malloc(sizeof(*ret));
     *ret = (struct Case){
         CASE_TYPE, .type = {
             name,
@@ -24,7 +31,7 @@ struct Case *
 new_ExprCase(AST *expr, struct Vector *stmts) {
     struct Case *ret;
 
-    ret = safe_malloc(sizeof(*ret));
+    ret = arena_malloc(sizeof(*ret));
     *ret = (struct Case){
         CASE_EXPR, .expr = expr,
         stmts
@@ -72,7 +79,7 @@ json_case(const struct Case *c, FILE *out, int indent) {
 
 struct Argument *
 new_Argument(AST *ast, unsigned char isRef) {
-    struct Argument *arg = safe_malloc(sizeof(*arg));
+    struct Argument *arg = arena_malloc(sizeof(*arg));
     *arg = (struct Argument){
         ast,
         isRef
@@ -86,39 +93,66 @@ json_Argument(const struct Argument *arg, FILE *out, int indent) {
 }
 
 void
-delete_Argument(struct Argument *arg) {
-    delete_AST(arg->ast);
-    free(arg);
-}
-
-void
-delete_field(struct Field *field) {
-    delete_Vector(field->names, free);
-    delete_type(field->type);
-    free(field);
+fold_vector(struct Vector *asts, struct FoldState *state) {
+    size_t n = Vector_size(asts);
+    for (size_t i = 0; i < n; i++) {
+        AST *ast = Vector_get(asts, i);
+        Vector_set(asts, i, ast->fold(ast, state));
+    }
 }
 
-void
-delete_ctor(Vector *ctor) {
-    delete_Vector(ctor, (VEC_DELETE_FUNC)delete_type);
+Vector *
+codeGenLocals(Scope *symbols, FILE *out, struct CodeGenState *state) {
+    Vector *cells = Vector(); // Vector<interned char*>
+    if (NULL != symbols) {
+        Iterator *it = Scope_iterator(symbols);
+        while (it->hasNext(it)) {
+            MapIterData data = it->next(it);
+            // Symbols of enclosing scopes that the block initializes are
+            // copied into its scope, but they are declared by their own.
+            if (!Scope_declares(symbols, data.key, data.len)) {
+                continue;
+            }
+            char *symbol = *(char **)data.key;
+            if (codeGenLocal(symbol, data.value, out, state)) {
+                Vector_append(cells, symbol);
+            }
+        }
+        it->delete(it);
+    }
+    return cells;
 }
 
 void
-delete_case(struct Case *c) {
-    switch (c->caseType) {
-        case CASE_EXPR:
-            delete_AST(c->expr);
-            break;
-        case CASE_TYPE:
-            free(c->type.name);
-            delete_type(c->type.type);
-            break;
+codeGenStmts(Vector *stmts,
+    Vector *cells,
+    FILE *out,
+    struct CodeGenState *state) {
+    size_t n = Vector_size(stmts);
+    for (size_t i = 0; i < n; i++) {
+        AST *stmt = Vector_get(stmts, i);
+        state->prev = 0 == i
+            ? NULL
+            : Vector_get(stmts, i - 1);
+        state->stmt = stmt;
+        char *code = stmt->codeGen(stmt, out, state);
+        free(code);
     }
-    delete_Vector(c->stmts, (VEC_DELETE_FUNC)delete_AST);
-    free(c);
+    size_t ncells = Vector_size(cells);
+    for (size_t i = 0; i < ncells; i++) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "#undef %s\n",
+            intern_mangled(Vector_get(cells, i)));
+    }
+    delete_Vector(cells, NULL);
 }
 
-inline void
-delete_AST(AST *this) {
-    ((AST *)this)->delete(this);
+void
+codeGenBlock(Scope *symbols,
+    Vector *stmts,
+    FILE *out,
+    struct CodeGenState *state) {
+    Vector *cells = codeGenLocals(symbols, out, state);
+    codeGenStmts(stmts, cells, out, state);
 }
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -42,32 +43,43 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return 0;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* ARRAY NOT IMPLEMENTED */");
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     ASTArray *ast = this;
-    delete_type(ast->array_type);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+    const Type *elem = ((const struct ArrayType *)ast->super.type)->type;
+    char *typeName = elem->codeGen(elem, NULL);
+    char *code = safe_asprintf("new_array(%lld, sizeof(%s))",
+        ast->index,
+        typeName);
+    free(typeName);
+    return code;
+}
+
+int
+ASTArray_length(const AST *ast, long long int *length) {
+    if (codeGen != ast->codeGen) {
+        return 1;
     }
-    free(this);
+    *length = ((const ASTArray *)ast)->index;
+    return 0;
 }
 
 AST *
 new_ASTArray(struct YYLTYPE loc, Type *array_type, long long int index) {
     ASTArray *array = NULL;
 
-    array = safe_malloc(sizeof(*array));
+    array = arena_malloc(sizeof(*array));
     *array = (ASTArray){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
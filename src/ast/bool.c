@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -28,44 +29,44 @@ json(const void *this, FILE *out, int indent) {
 }
 
 static int
-getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
+getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTBool *ast = this;
-    char *msg;
-    if (ast->super.type->verify(ast->super.type, state, &msg)) {
-        print_code_error(stderr, ast->super.loc, "%s", msg);
-        free(msg);
-        return 1;
-    }
-    *typeptr = ast->super.type;
+    *typeptr = ast->super.type = BuiltinType(BUILTIN_BOOL, state);
     return 0;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* BOOL NOT IMPLEMENTED */");
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     ASTBool *ast = this;
-    delete_type(ast->super.type);
-    free(ast);
+    return safe_strdup(ast->val
+        ? "1"
+        : "0");
+}
+
+int
+ASTBool_value(const AST *ast, int *val) {
+    if (codeGen != ast->codeGen) {
+        return 1;
+    }
+    *val = ((const ASTBool *)ast)->val;
+    return 0;
 }
 
 AST *
 new_ASTBool(YYLTYPE loc, int val) {
     ASTBool *node = NULL;
-    Type *type;
-
-    type = new_ObjectType(loc, safe_strdup("bool"), Vector());
-    type->init = 1;
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTBool){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
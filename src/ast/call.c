@@ -1,9 +1,13 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
+#include "overload.h"
+#include "map.h"
+#include "escape.h"
 
 typedef struct ASTCall ASTCall;
 
@@ -13,6 +17,7 @@ struct ASTCall {
     Vector *args;     // Vector<struct Argument*>
     // NULL until type checker is executed:
     Vector *argTypes; // Vector<Type*>, types don't need to be deleted
+    struct FuncType *match; // The overload being called
 };
 
 static void
@@ -38,6 +43,10 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     if (ast->expr->getType(ast->expr, state, &funcType)) {
         return 1;
     }
+    const char *callee = ASTVariable_name(ast->expr);
+    if (NULL != callee) {
+        Escapes_call(state->escapes, callee);
+    }
     if (TYPE_FUNC != funcType->type) {
         char *typeName = funcType->toString(funcType);
         print_code_error(stderr,
@@ -57,47 +66,33 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
             continue;
         }
         Vector_append(ast->argTypes, givenType);
+        const char *name = ASTVariable_name(arg->ast);
+        if (arg->isRef && NULL != name) {
+            // The callee can assign to it.
+            BindSymbol(state, name, NULL);
+        }
     }
     if (status) {
         return 1;
     }
-    int found = 0;
-    for (struct FuncType *func = (struct FuncType *)funcType;
-        NULL != func;
-        func = func->next) {
-        // TODO: generic functions
-        size_t nargs = Vector_size(func->args);
-        if (nargs != ngiven) {
-            continue;
-        }
-        int valid = 1;
-        for (size_t j = 0; j < nargs; j++) {
-            struct Argument *arg = Vector_get(ast->args, j);
-            Type *givenType = Vector_get(ast->argTypes, j),
-                *expectType = Vector_get(func->args, j);
-            if (expectType->isRef != arg->isRef) {
-                valid = 0;
-                break;
-            }
-            if (givenType->compare(givenType, expectType, state)) {
-                valid = 0;
-                break;
-            }
-        }
-        if (!valid) {
-            continue;
-        }
-        if (found) {
-            print_code_error(stderr,
-                ast->super.loc,
-                "%s",
-                "overloaded function call is ambiguous");
-            status = 1;
-            continue;
-        }
-        found = 1;
+    // TODO: generic functions
+    struct FuncType *func;
+    int found = ResolveOverload((struct FuncType *)funcType,
+        ast->args,
+        ast->argTypes,
+        state,
+        &func);
+    if (0 < found) {
+        ast->match = func;
         *typeptr = ast->super.type = func->ret_type->copy(func->ret_type);
     }
+    if (1 < found) {
+        print_code_error(stderr,
+            ast->super.loc,
+            "%s",
+            "overloaded function call is ambiguous");
+        status = 1;
+    }
     if (0 == found) {
         dstring str = dstring("no matching function call with argument type");
         if (ngiven > 1) {
@@ -119,36 +114,143 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return status;
 }
 
+/*
+ * Returns the name of the function literal that is always called if the call
+ * goes through a variable only ever bound to that literal, otherwise NULL.
+ */
+static const char *
+direct_callee(const ASTCall *ast, const CodeGenState *state) {
+    const char *var = ASTVariable_name(ast->expr);
+    AST *func;
+    char *name;
+    if (NULL == var || NULL == ast->match->ast ||
+        Map_get(state->bindings, &var, sizeof(var), &func) ||
+        func != ast->match->ast ||
+        Map_get(state->funcIDs, &func->type, sizeof(func->type), &name)) {
+        return NULL;
+    }
+    return name;
+}
+
+/*
+ * Returns the C expression for the closure of the overload of the function
+ * code with type from that has the signature of to, which is code itself
+ * unless from has more than one signature.
+ */
 static char *
-codeGen(void *this, FILE *out, CodeGenState *state) {
-    const ASTCall *ast = this;
-    const struct FuncType *func = (struct FuncType *)ast->expr->type;
-    char *code = ast->expr->codeGen(ast->expr, out, state);
+select_overload(const Type *from, const Type *to, const char *code) {
+    if (TYPE_FUNC != to->type || !IsOverloaded(from)) {
+        return safe_strdup(code);
+    }
+    size_t index = FindOverload((const struct FuncType *)from,
+        (const struct FuncType *)to);
+    return safe_asprintf("(%s).f%zu", code, index);
+}
+
+/*
+ * Emit the arguments of the call and return them as a C argument list, with
+ * a leading comma for each. Each argument is evaluated before the code of
+ * the next one runs.
+ */
+static char *
+codeGenArgs(const ASTCall *ast, FILE *out, CodeGenState *state) {
+    dstring args = dstring("");
     size_t n = Vector_size(ast->args);
-    char *args[n];
     for (size_t i = 0; i < n; i++) {
         struct Argument *arg = Vector_get(ast->args, i);
         char *argCode = arg->ast->codeGen(arg->ast, out, state);
-        args[i] = argCode;
+        if (arg->isRef) {
+            vappend_str(&args, ", &%s", argCode);
+        } else {
+            const Type *type = Vector_get(ast->match->args, i);
+            char *value = select_overload(arg->ast->type, type, argCode);
+            free(argCode);
+            argCode = value;
+            char *tmpName = safe_asprintf("temp%d", state->tempCount);
+            state->tempCount++;
+            char *typeName = type->codeGen(type, tmpName);
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "%s = %s;\n", typeName, argCode);
+            free(typeName);
+            vappend_str(&args, ", %s", tmpName);
+            free(tmpName);
+        }
+        free(argCode);
     }
-    char *argsName = safe_asprintf("temp%d", state->tempCount);
-    state->tempCount++;
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "void* %s[] = {", argsName);
-    char *sep = " ";
+    return args.str;
+}
+
+static char *
+codeGenClosureCall(const ASTCall *ast, FILE *out, CodeGenState *state) {
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    const char *callee = direct_callee(ast, state);
+    char *ret;
+    if (NULL != callee) {
+        char *args = codeGenArgs(ast, out, state);
+        if (ASTFunc_lifted(ast->match->ast, state)) {
+            // There is no environment to pass.
+            ret = safe_asprintf("%s(NULL%s)", callee, args);
+        } else {
+            ret = safe_asprintf("%s((%s).env%s)", callee, code, args);
+        }
+        free(args);
+    } else {
+        // Copy the closure so it is only evaluated once.
+        struct FuncType closureType = *ast->match;
+        closureType.super.isRef = 0;
+        closureType.next = NULL;
+        char *tmpName = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        char *typeName = closureType.super.codeGen(&closureType, tmpName);
+        char *value = select_overload(ast->expr->type,
+            &closureType.super,
+            code);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "%s = %s;\n", typeName, value);
+        free(typeName);
+        free(value);
+        char *args = codeGenArgs(ast, out, state);
+        ret = safe_asprintf("%s.fn(%s.env%s)", tmpName, tmpName, args);
+        free(args);
+        free(tmpName);
+    }
+    free(code);
+    return ret;
+}
+
+static AST *
+fold(void *this, FoldState *state) {
+    ASTCall *ast = this;
+    ast->expr = ast->expr->fold(ast->expr, state);
+    size_t n = Vector_size(ast->args);
     for (size_t i = 0; i < n; i++) {
         struct Argument *arg = Vector_get(ast->args, i);
-        fprintf(out, "%s", sep);
-        if (arg->isRef || TYPE_FUNC == arg->ast->type->type) {
-            fprintf(out, "&");
+        if (!arg->isRef) {
+            arg->ast = arg->ast->fold(arg->ast, state);
         }
-        fprintf(out, "%s", args[i]);
-        sep = ", ";
-        free(args[i]);
     }
-    fprintf(out, " };\n");
+    AST *value = foldOperator(this, ast->expr, ast->args);
+    return NULL == value
+        ? this
+        : value;
+}
+
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
+    const ASTCall *ast = this;
+    const struct FuncType *func = ast->match;
+    char *value = codeGenOperator(ast->expr, ast->args, out, state);
+    if (NULL == value) {
+        value = codeGenClosureCall(ast, out, state);
+    }
     char *tmpName = NULL;
-    if (TYPE_NONE != func->ret_type->type) {
+    if (state->stmt == this) {
+        // The value of an expression statement is never read.
+        fprintf(out, "%*s", state->indent * 4, "");
+        if (TYPE_NONE != func->ret_type->type) {
+            fprintf(out, "(void)");
+        }
+    } else if (TYPE_NONE != func->ret_type->type) {
         tmpName = safe_asprintf("temp%d", state->tempCount);
         state->tempCount++;
         char *typeName = ast->super.type->codeGen(ast->super.type, tmpName);
@@ -158,40 +260,40 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     } else {
         fprintf(out, "%*s", state->indent * 4, "");
     }
-    fprintf(out, "CALL(%s, %s);\n", code, argsName);
-    free(code);
-    free(argsName);
+    fprintf(out, "%s;\n", value);
+    free(value);
     return tmpName;
 }
 
-static void
-delete(void *this) {
-    ASTCall *ast = this;
-    delete_AST(ast->expr);
-    delete_Vector(ast->args, (VEC_DELETE_FUNC)delete_Argument);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
-        delete_Vector(ast->argTypes, NULL);
+int
+ASTCall_operator(const AST *ast,
+    const AST **lhs,
+    const char **op,
+    const AST **rhs) {
+    if (codeGen != ast->codeGen) {
+        return 1;
     }
-    free(this);
+    const ASTCall *call = (const ASTCall *)ast;
+    return matchOperator(call->expr, call->args, lhs, op, rhs);
 }
 
 AST *
 new_ASTCall(YYLTYPE loc, AST *expr, Vector *args) {
     ASTCall *call = NULL;
 
-    call = safe_malloc(sizeof(*call));
+    call = arena_malloc(sizeof(*call));
     *call = (ASTCall){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
         expr,
         args,
+        NULL,
         NULL
     };
     return (AST *)call;
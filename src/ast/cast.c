@@ -1,9 +1,12 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 #include "map.h"
+#include "intern.h"
+#include "overload.h"
 
 typedef struct ASTCast ASTCast;
 
@@ -54,9 +57,9 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     }
     const struct ObjectType *object = (const struct ObjectType *)exprType;
     const struct ClassType *class = object->class;
-    const char *fieldName = "=>";
+    const char *fieldName = intern("=>");
     Type *fieldType;
-    if (Map_get(class->fieldTypes, fieldName, strlen(fieldName), &fieldType)) {
+    if (Map_get(class->fieldTypes, &fieldName, sizeof(fieldName), &fieldType)) {
         char *typeName = exprType->toString(exprType);
         print_code_error(stderr,
             ast->expr->loc,
@@ -65,14 +68,13 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
         free(typeName);
         return 1;
     }
-    for (struct FuncType *func = (struct FuncType *)fieldType;
-        NULL != func;
-        func = func->next) {
-        if (!func->ret_type->compare(func->ret_type, ast->super.type, state)) {
-            // Found right cast
-            *typeptr = ast->super.type;
-            return 0;
-        }
+    struct FuncType *func;
+    if (!ResolveCast((struct FuncType *)fieldType,
+        ast->super.type,
+        state,
+        &func)) {
+        *typeptr = ast->super.type;
+        return 0;
     }
     char *typeName = exprType->toString(exprType);
     char *castName = ast->super.type->toString(ast->super.type);
@@ -86,51 +88,85 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return 1;
 }
 
-static char *
-codeGen(void *this, FILE *out, CodeGenState *state) {
+static AST *
+fold(void *this, FoldState *state) {
     ASTCast *ast = this;
-    char *code = ast->expr->codeGen(ast->expr, out, state);
+    ast->expr = ast->expr->fold(ast->expr, state);
+    AST *value = foldBuiltinCast(this, ast->expr);
+    return NULL == value
+        ? this
+        : value;
+}
+
+/*
+ * Returns the C expression that casts the value of expr, whose C expression
+ * is code, to an instance of the class named to. Frees code.
+ */
+static char *
+cast_to(const AST *expr,
+    char *code,
+    const char *to,
+    FILE *out,
+    CodeGenState *state) {
+    const struct ClassType *class =
+        ((const struct ObjectType *)expr->type)->class;
+    if (0 < class->id && class->id <= NUM_BUILTINS) {
+        // Builtins have no subclasses, so call the cast directly.
+        char *ret = safe_asprintf("class_%s_cast_class_%s_direct(%s)",
+            class->name,
+            to,
+            code);
+        free(code);
+        return ret;
+    }
     fprintf(out, "%*s", state->indent * 4, "");
     char *tmpName = safe_asprintf("temp%d", state->tempCount);
     state->tempCount++;
-    char *typeName = ast->expr->type->codeGen(ast->expr->type, tmpName);
+    char *typeName = expr->type->codeGen(expr->type, tmpName);
     fprintf(out, "%s = %s;\n", typeName, code);
     free(typeName);
     free(code);
-    char *castType = ast->super.type->codeGen(ast->super.type, NULL);
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out,
-        "closure temp%d = { %s->cast_%s, (void*[]){%s} };\n",
-        state->tempCount,
+    char *ret = safe_asprintf("%s->vtable->cast_class_%s(%s)",
         tmpName,
-        castType,
+        to,
         tmpName);
-    free(castType);
     free(tmpName);
-    char *ret = safe_asprintf("CALL(temp%d, NULL)", state->tempCount);
-    state->tempCount++;
     return ret;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTCast *ast = this;
-    delete_AST(ast->expr);
-    delete_type(ast->super.type);
-    free(this);
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    const struct ObjectType *castType =
+        (const struct ObjectType *)ast->super.type;
+    return cast_to(ast->expr, code, castType->class->name, out, state);
+}
+
+char *
+codeGenCondition(AST *cond, FILE *out, CodeGenState *state) {
+    char *code = cond->codeGen(cond, out, state);
+    const struct ClassType *class =
+        ((const struct ObjectType *)cond->type)->class;
+    if (0 < class->id && class->id <= NUM_BUILTINS &&
+        !strcmp(class->name, "bool")) {
+        // Already an unboxed bool, so there is nothing to cast.
+        return code;
+    }
+    return cast_to(cond, code, "bool", out, state);
 }
 
 AST *
 new_ASTCast(struct YYLTYPE loc, AST *expr, Type *type) {
     ASTCast *cast = NULL;
 
-    cast = safe_malloc(sizeof(*cast));
+    cast = arena_malloc(sizeof(*cast));
     *cast = (ASTCast){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             type
         },
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
@@ -37,17 +38,18 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     }
     if (TYPE_TUPLE == type->type) {
         const struct TupleType *tuple = (const struct TupleType *)type;
-        unsigned int n = SparseVector_count(tuple->types);
-        if (ast->index < 0 || ast->index >= n) {
+        unsigned long long n = SparseVector_count(tuple->types);
+        if (ast->index < 0 || (unsigned long long)ast->index >= n) {
             print_code_error(stderr,
                 ast->super.loc,
-                "tuple indexed at %ld is out of range, tuple has %ld "
+                "tuple indexed at %lld is out of range, tuple has %llu "
                 "elements",
                 ast->index,
                 n);
             return 1;
         }
         SparseVector_at(tuple->types, ast->index, typeptr);
+        ast->super.type = *typeptr;
         return 0;
     } else if (TYPE_ARRAY == type->type) {
         const struct ArrayType *array = (const struct ArrayType *)type;
@@ -64,29 +66,42 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return 1;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* CONST INDEX NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTConstIndex *ast = this;
+    ast->expr = ast->expr->fold(ast->expr, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTConstIndex *ast = this;
-    delete_AST(ast->expr);
-    free(this);
+    const Type *type = ast->expr->type;
+    if (TYPE_ARRAY == type->type) {
+        // Indexed like an array with an int literal, which checks it.
+        AST *index = ASTInt(ast->super.loc, ast->index);
+        return codeGenIndex(ast->expr, index, out, state);
+    }
+    // The element is read straight from the field of its run.
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    char *field = TupleType_field((const struct TupleType *)type,
+        code,
+        ast->index);
+    free(code);
+    return field;
 }
 
 AST *
 new_ASTConstIndex(YYLTYPE loc, AST *expr, long long int index) {
     ASTConstIndex *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTConstIndex){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
@@ -1,9 +1,13 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
+#include "escape.h"
 
 typedef struct ASTDefinition ASTDefinition;
 
@@ -59,6 +63,7 @@ handle_spread(const struct SpreadType *spread,
                 : "s");
         return 1;
     }
+    ast->varTypes = Vector();
     size_t sparse_size = SparseVector_size(spread->types);
     size_t var_index = 0;
     for (size_t i = 0; i < sparse_size; i++) {
@@ -68,23 +73,28 @@ handle_spread(const struct SpreadType *spread,
         for (unsigned long long j = 0; j < count; j++) {
             char *name = Vector_get(ast->vars, var_index);
             if (NULL != name) {
-                size_t len = strlen(name);
                 if (NULL != state->usedSymbols) {
-                    Map_put(state->usedSymbols, name, len, NULL, NULL);
+                    Map_put(state->usedSymbols,
+                        &name,
+                        sizeof(name),
+                        NULL,
+                        NULL);
                 }
-                type->init = 1;
+                BindSymbol(state, name, ast->expr);
                 char *msg;
-                Type *type_copy = copy_type(type);
                 if (AddSymbol(state->symbols,
                     name,
-                    len,
-                    type_copy,
-                    1,
+                    copy_type_init(type),
+                    0,
                     state,
                     &msg)) {
                     print_code_error(stderr, ast->super.loc, "%s", msg);
                     free(msg);
                     status = 1;
+                } else {
+                    Type *varType;
+                    Scope_get(state->symbols, &name, sizeof(name), &varType);
+                    Vector_append(ast->varTypes, varType);
                 }
             }
             var_index++;
@@ -119,20 +129,19 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     }
     // Right-hand expression is not a spread tuple
     ast->varTypes = Vector();
+    Type *initType = copy_type_init(exprType);
     for (size_t i = 0; i < nvars; i++) {
         char *name = Vector_get(ast->vars, i);
         if (name != NULL) {
             //Not an ignored variable (_)
-            size_t len = strlen(name);
             if (NULL != state->usedSymbols) {
-                Map_put(state->usedSymbols, name, len, NULL, NULL);
+                Map_put(state->usedSymbols, &name, sizeof(name), NULL, NULL);
             }
-            exprType->init = 1;
+            BindSymbol(state, name, ast->expr);
             char *msg;
             if (AddSymbol(state->symbols,
                 name,
-                len,
-                exprType,
+                initType,
                 1,
                 state,
                 &msg)) {
@@ -141,11 +150,17 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
                 status = 1;
             } else {
                 Type *prevType;
-                if (Map_get(state->symbols, name, len, &prevType)) {
-                    Vector_append(ast->varTypes, exprType);
-                } else {
-                    Vector_append(ast->varTypes, prevType);
+                if (Scope_get(state->symbols, &name, sizeof(name), &prevType)) {
+                    prevType = exprType;
                 }
+                Vector_append(ast->varTypes, prevType);
+                // Inside a control flow statement, only the symbols that the
+                // block itself declares go out of scope with it.
+                Escapes_bind(state->escapes,
+                    ast->expr,
+                    name,
+                    !prevType->isRef && (state->symbols == state->frame ||
+                        Scope_declares(state->symbols, &name, sizeof(name))));
             }
         }
     }
@@ -153,49 +168,208 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return status;
 }
 
+/*
+ * Emit the assignment of the function value code, which has type from, to
+ * the variable var, whose type is the list of overloads to. Each closure of
+ * from is stored as the closure of to with its signature.
+ */
+static void
+assign_overloads(const char *var,
+    const struct FuncType *to,
+    const char *code,
+    const struct FuncType *from,
+    FILE *out,
+    const CodeGenState *state) {
+    const char *deref = to->super.isRef
+        ? "*"
+        : "";
+    if (!IsOverloaded(&from->super)) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "(%s%s).f%zu = %s;\n",
+            deref,
+            var,
+            FindOverload(to, from),
+            code);
+        return;
+    }
+    for (const struct FuncType *func = from; NULL != func; func = func->next) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "(%s%s).f%zu = (%s).f%zu;\n",
+            deref,
+            var,
+            FindOverload(to, func),
+            code,
+            FindOverload(from, func));
+    }
+}
+
+static AST *
+fold(void *this, FoldState *state) {
+    ASTDefinition *ast = this;
+    AST *expr = ast->expr->fold(ast->expr, state);
+    if (expr == ast->expr) {
+        return this;
+    }
+    // Symbols bound to the expression are now bound to its value.
+    size_t n = Vector_size(ast->vars);
+    for (size_t i = 0; i < n; i++) {
+        char *var = Vector_get(ast->vars, i);
+        AST *value;
+        if (NULL != var &&
+            !Map_get(state->bindings, &var, sizeof(var), &value) &&
+            value == ast->expr) {
+            Map_put(state->bindings, &var, sizeof(var), expr, NULL);
+        }
+    }
+    ast->expr = expr;
+    return this;
+}
+
+/*
+ * Returns 1 if the value the definition binds can be read afterwards, which
+ * it can't if none of its variables are ever read or are references.
+ */
+static int
+is_read(const ASTDefinition *ast, const CodeGenState *state) {
+    size_t n = Vector_size(ast->vars);
+    size_t nassigned = 0;
+    for (size_t i = 0; i < n; i++) {
+        char *var = Vector_get(ast->vars, i);
+        if (NULL == var) {
+            continue;
+        }
+        const Type *varType = Vector_get(ast->varTypes, nassigned++);
+        if (varType->isRef || Escapes_read(state->escapes, var)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Emit the definition of the variables from the values of a spread tuple,
+ * each assigned on its own without building the tuple.
+ */
+static void
+codeGen_spread(const ASTDefinition *ast, FILE *out, CodeGenState *state) {
+    const struct SpreadType *spread =
+        (const struct SpreadType *)ast->expr->type;
+    Vector *values = codeGenSpread(ast->expr, out, state);
+    size_t n = Vector_size(ast->vars);
+    size_t nassigned = 0;
+    for (size_t i = 0; i < n; i++) {
+        char *var = Vector_get(ast->vars, i);
+        if (NULL == var) {
+            continue;
+        }
+        Type *varType = Vector_get(ast->varTypes, nassigned++);
+        const char *value = Vector_get(values, i);
+        if (IsOverloaded(varType)) {
+            Type *valueType;
+            SparseVector_at(spread->types, i, &valueType);
+            assign_overloads(intern_mangled(var),
+                (const struct FuncType *)varType,
+                value,
+                (const struct FuncType *)valueType,
+                out,
+                state);
+            continue;
+        }
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "%s%s = %s;\n",
+            varType->isRef
+                ? "*"
+                : "",
+            intern_mangled(var),
+            value);
+    }
+    delete_Vector(values, free);
+}
+
 static char *
 codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTDefinition *ast = this;
-    char *code = ast->expr->codeGen(ast->expr, out, state);
-    fprintf(out, "%*s", state->indent * 4, "");
+    const Type *exprType = ast->expr->type;
     size_t n = Vector_size(ast->vars);
+    if (TYPE_SPREAD == exprType->type) {
+        codeGen_spread(ast, out, state);
+        return NULL;
+    }
+    if (TYPE_FUNC == exprType->type &&
+        ((const struct FuncType *)exprType)->ast == ast->expr &&
+        !is_read(ast, state)) {
+        // Nothing can call the closure, so its function isn't emitted.
+        return NULL;
+    }
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    size_t nassigned = 0, nplain = 0;
     for (size_t i = 0; i < n; i++) {
         char *var = Vector_get(ast->vars, i);
-        if (NULL != var) {
-            Type *varType = Vector_get(ast->varTypes, i);
-            if (varType->isRef) {
-                fprintf(out, "*");
-            }
-            fprintf(out, "var_%s = ", var);
+        if (NULL == var) {
+            continue;
+        }
+        Type *varType = Vector_get(ast->varTypes, nassigned++);
+        if (IsOverloaded(varType)) {
+            // Overloaded variables are assigned after the others.
+            continue;
+        }
+        if (0 == nplain++) {
+            fprintf(out, "%*s", state->indent * 4, "");
+        }
+        if (varType->isRef) {
+            fprintf(out, "*");
+        }
+        fprintf(out, "%s = ", intern_mangled(var));
+    }
+    if (0 < nplain) {
+        fprintf(out, "%s;\n", code);
+    }
+    nassigned = 0;
+    for (size_t i = 0; i < n; i++) {
+        char *var = Vector_get(ast->vars, i);
+        if (NULL == var) {
+            continue;
+        }
+        Type *varType = Vector_get(ast->varTypes, nassigned++);
+        if (IsOverloaded(varType)) {
+            assign_overloads(intern_mangled(var),
+                (const struct FuncType *)varType,
+                code,
+                (const struct FuncType *)exprType,
+                out,
+                state);
         }
     }
-    fprintf(out, "%s;\n", code);
     free(code);
     return NULL;
 }
 
-static void
-delete(void *this) {
-    ASTDefinition *ast = this;
-    delete_Vector(ast->vars, free);
-    if (NULL != ast->varTypes) {
-        delete_Vector(ast->varTypes, NULL);
+const char *
+ASTDefinition_int(const AST *ast, long long int *val) {
+    if (codeGen != ast->codeGen) {
+        return NULL;
+    }
+    const ASTDefinition *def = (const ASTDefinition *)ast;
+    if (1 != Vector_size(def->vars) || ASTInt_value(def->expr, val)) {
+        return NULL;
     }
-    delete_AST(ast->expr);
-    free(this);
+    return Vector_get(def->vars, 0);
 }
 
 AST *
 new_ASTDefinition(YYLTYPE loc, Vector *vars, AST *expr) {
     ASTDefinition *definition = NULL;
 
-    definition = safe_malloc(sizeof(*definition));
+    definition = arena_malloc(sizeof(*definition));
     *definition = (ASTDefinition){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
@@ -1,9 +1,13 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
+#include "vector.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
 
 typedef struct ASTDo ASTDo;
 
@@ -11,7 +15,7 @@ struct ASTDo {
     AST super;
     AST *cond;
     Vector *stmts;  // Vector<AST*>
-    Map *symbols;   // NULL until type checker is executed.
+    Scope *symbols; // NULL until type checker is executed.
 };
 
 static void
@@ -48,11 +52,11 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     } else {
         const struct ObjectType *object = (const struct ObjectType *)condType;
         const struct ClassType *class = object->class;
-        const char *fieldName = "=>";
+        const char *fieldName = intern("=>");
         Type *fieldType;
         if (Map_get(class->fieldTypes,
-            fieldName,
-            strlen(fieldName),
+            &fieldName,
+            sizeof(fieldName),
             &fieldType)) {
             char *typeName = condType->toString(condType);
             print_code_error(stderr,
@@ -71,7 +75,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
                     *ret = (const struct ObjectType *)func->ret_type;
                 if (TYPE_OBJECT == func->ret_type->type &&
                     !ret->class->super.compare(ret->class,
-                        state->builtins[BUILTIN_BOOL],
+                        BuiltinClass(BUILTIN_BOOL, state),
                         state)) {
                     // Found right cast
                     found = 1;
@@ -90,15 +94,15 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
             }
         }
     }
-    Map *prevSymbols = state->symbols;
+    Scope *prevSymbols = state->symbols;
     Map *prevInit = state->newInitSymbols;
     Type *prevRet = state->retType;
     state->retType = NULL;
     state->newInitSymbols = Map();
     size_t nstmts = Vector_size(ast->stmts);
     if (nstmts > 0) {
-        state->symbols = ast->symbols =
-            copy_Map(state->symbols, (MAP_COPY_FUNC)copy_type);
+        state->symbols = ast->symbols = Scope(state->symbols);
+        Vector_append(state->scopes, ast->symbols);
     }
     for (size_t i = 0; i < nstmts; i++) {
         AST *stmt = Vector_get(ast->stmts, i);
@@ -110,9 +114,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     Iterator *it = Map_iterator(state->newInitSymbols);
     while (it->hasNext(it)) {
         MapIterData symbol = it->next(it);
-        Type *type = NULL;
-        if (!Map_get(prevSymbols, symbol.key, symbol.len, &type)) {
-            type->init = 1;
+        if (!InitSymbol(prevSymbols, symbol.key, symbol.len)) {
             if (NULL != prevInit) {
                 Map_put(prevInit, symbol.key, symbol.len, NULL, NULL);
             }
@@ -129,29 +131,53 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     return status;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* DO NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTDo *ast = this;
+    fold_vector(ast->stmts, state);
+    ast->cond = ast->cond->fold(ast->cond, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTDo *ast = this;
-    delete_AST(ast->cond);
-    delete_Vector(ast->stmts, (VEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->symbols) {
-        delete_Map(ast->symbols, (MAP_DELETE_FUNC)delete_type);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "do {\n");
+    state->indent++;
+    codeGenBlock(ast->symbols, ast->stmts, out, state);
+    // The statements that the condition takes are local to the loop's body,
+    // so if there are any the loop is left from inside it.
+    FILE *condOut = safe_tmpfile();
+    char *cond = codeGenCondition(ast->cond, condOut, state);
+    if (0 == ftell(condOut)) {
+        fclose(condOut);
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "} while (%s);\n", cond);
+    } else {
+        copy_file(condOut, out);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "if (!(%s)) {\n", cond);
+        fprintf(out, "%*s", (state->indent + 1) * 4, "");
+        fprintf(out, "break;\n");
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "} while (1);\n");
     }
-    free(this);
+    free(cond);
+    return NULL;
 }
 
 AST *
 new_ASTDo(YYLTYPE loc, AST *cond, struct Vector *stmts) {
     ASTDo *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTDo){
-        { json, getType, codeGen, delete, loc, NULL }, cond, stmts, NULL
+        { json, getType, fold, codeGen, loc, NULL }, cond, stmts, NULL
     };
     return (AST *)node;
 }
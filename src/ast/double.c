@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -24,47 +25,59 @@ json(const void *this, FILE *out, int indent) {
 }
 
 static int
-getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
+getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTDouble *ast = this;
-    char *msg;
-    if (ast->super.type->verify(ast->super.type, state, &msg)) {
-        print_code_error(stderr, ast->super.loc, "%s", msg);
-        free(msg);
-        return 1;
-    }
-    *typeptr = ast->super.type;
+    *typeptr = ast->super.type = BuiltinType(BUILTIN_DOUBLE, state);
     return 0;
 }
 
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
+}
+
 static char *
 codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     ASTDouble *ast = this;
-    return safe_asprintf("builtin_double(%f)", ast->val);
+    // Print the shortest literal that reads back as the same value, since
+    // folded values aren't limited to what was written in the source.
+    char *ret = NULL;
+    for (int precision = 15; precision <= 17; precision++) {
+        free(ret);
+        ret = safe_asprintf("%.*g", precision, ast->val);
+        if (strtod(ret, NULL) == ast->val) {
+            break;
+        }
+    }
+    if (NULL == strpbrk(ret, ".e")) {
+        char *tmp = safe_asprintf("%s.0", ret);
+        free(ret);
+        ret = tmp;
+    }
+    return ret;
 }
 
-static void
-delete(void *this) {
-    ASTDouble *ast = this;
-    delete_type(ast->super.type);
-    free(this);
+int
+ASTDouble_value(const AST *ast, double *val) {
+    if (codeGen != ast->codeGen) {
+        return 1;
+    }
+    *val = ((const ASTDouble *)ast)->val;
+    return 0;
 }
 
 AST *
 new_ASTDouble(YYLTYPE loc, double val) {
     ASTDouble *node = NULL;
-    Type *type;
-
-    type = new_ObjectType(loc, safe_strdup("double"), Vector());
-    type->init = 1;
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTDouble){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
-            type
+            NULL
         },
         val
     };
@@ -1,11 +1,16 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
 #include "types.h"
 #include "parser.h"
+#include "dynamic_string.h"
+#include "escape.h"
 
 typedef struct ASTFunc ASTFunc;
 
@@ -15,8 +20,8 @@ struct ASTFunc {
     Vector *args;     // Vector<Field*>
     Type *ret_type;
     Vector *stmts;    // Vector<AST*>
-    Map *symbols;     // NULL until type checker is executed.
-    Map *locals;      // Map<char*, NULL>
+    Scope *symbols;   // NULL until type checker is executed.
+    Map *locals;      // Map<interned char*, NULL>
 };
 
 static void
@@ -57,7 +62,7 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     }
     Vector *args = Vector();
     Vector *argNames = Vector();
-    ast->symbols = copy_Map(state->symbols, (MAP_COPY_FUNC)copy_type);
+    ast->symbols = Scope(state->symbols);
     ast->locals = Map();
     size_t nargs = Vector_size(ast->args);
     for (size_t i = 0; i < nargs; i++) {
@@ -73,14 +78,13 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
             for (size_t j = 0; j < nnames; j++) {
                 char *name = Vector_get(arg->names, j);
                 Vector_append(argNames, name);
-                size_t len = strlen(name);
-                type_copy = copy_type(arg->type);
-                type_copy->init = 1;
-                Type *prev_type = NULL;
-                Map_put(ast->symbols, name, len, type_copy, &prev_type);
-                if (NULL != prev_type) {
-                    delete_type(prev_type);
-                }
+                BindSymbol(state, name, this);
+                type_copy = copy_type_init(arg->type);
+                Scope_put(ast->symbols,
+                    &name,
+                    sizeof(name),
+                    type_copy,
+                    NULL);
             }
         }
     }
@@ -90,17 +94,17 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
         status = 1;
     }
     if (status) {
-        delete_Vector(args, (VEC_DELETE_FUNC)delete_type);
         return 1;
     }
     Type *prevFuncType = state->funcType;
     Type *prevRetType = state->retType;
-    Map *prevSymbols = state->symbols;
+    Scope *prevSymbols = state->symbols;
     Map *prevNewSymbols = state->newSymbols;
     Map *prevUsedSymbols = state->usedSymbols;
+    Scope *prevFrame = state->frame;
     state->retType = NULL;
     state->funcType = ast->ret_type;
-    state->symbols = ast->symbols;
+    state->symbols = state->frame = ast->symbols;
     state->newSymbols = ast->locals;
     Map *used = state->usedSymbols = Map();
     size_t nstmts = Vector_size(ast->stmts);
@@ -126,8 +130,8 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     state->symbols = prevSymbols;
     state->newSymbols = prevNewSymbols;
     state->usedSymbols = prevUsedSymbols;
+    state->frame = prevFrame;
     if (status) {
-        delete_Vector(args, (VEC_DELETE_FUNC)delete_type);
         return 1;
     }
     Iterator *it = Map_iterator(ast->locals);
@@ -141,7 +145,7 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     nargs = Vector_size(argNames);
     for (size_t i = 0; i < nargs; i++) {
         char *arg = Vector_get(argNames, i);
-        Map_remove(used, arg, strlen(arg), NULL);
+        Map_remove(used, &arg, sizeof(arg), NULL);
     }
     delete_Vector(argNames, NULL);
     if (NULL != state->usedSymbols) {
@@ -159,136 +163,380 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     func->ast = this;
     func->env = used;
     Vector_append(state->functions, ast->super.type);
+    Escapes_alloc(state->escapes,
+        this,
+        func,
+        NULL != state->funcType,
+        state->symbols != state->frame);
     return 0;
 }
 
 void
-codeGenFuncBody(void *this, FILE *out, struct CodeGenState *state) {
-    ASTFunc *ast = this;
+codeGenFuncTypedefs(void *this, Map *seen, FILE *out) {
+    const ASTFunc *ast = this;
     Iterator *it = Map_iterator(ast->locals);
     while (it->hasNext(it)) {
         MapIterData data = it->next(it);
-        char *symbol = data.key;
-        size_t len = data.len;
         Type *type;
-        Map_get(ast->symbols, symbol, len, &type);
-        char *name = safe_asprintf("var_%.*s", (int)len, symbol);
-        char *typeName = type->codeGen(type, name);
-        free(name);
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "%s;\n", typeName);
-        free(typeName);
+        if (Scope_getLocal(ast->symbols, data.key, data.len, &type)) {
+            // Typedef'd with the scope of the block it is declared in.
+            continue;
+        }
+        typedef_Type(type, seen, out);
     }
     it->delete(it);
+}
 
-    struct FuncType *func = (struct FuncType *)ast->super.type;
-    it = Map_iterator(func->env);
-    int envID = 0;
+/*
+ * Returns 1 if the captured symbol is only ever bound once, so the closure
+ * can hold a copy of its value, or 0 if it must hold a pointer to it.
+ */
+static int
+captured_by_value(const char *symbol, const CodeGenState *state) {
+    AST *value;
+    return !Map_get(state->bindings, &symbol, sizeof(symbol), &value) &&
+        NULL != value;
+}
+
+/*
+ * Returns 1 if the captured symbol is held by the closure's environment, or 0
+ * if it is a C global that the function reads directly or its reads are all
+ * folded.
+ */
+static int
+in_env(const char *symbol, const CodeGenState *state) {
+    return !Map_contains(state->globals, &symbol, sizeof(symbol)) &&
+        !ASTVariable_folded(symbol, state->bindings);
+}
+
+static size_t
+env_size(const struct FuncType *func, const CodeGenState *state) {
+    size_t size = 0;
+    Iterator *it = Map_iterator(func->env);
+    while (it->hasNext(it)) {
+        size += in_env(*(char **)it->next(it).key, state);
+    }
+    it->delete(it);
+    return size;
+}
+
+int
+ASTFunc_lifted(const AST *ast, const CodeGenState *state) {
+    return 0 == env_size((const struct FuncType *)ast->type, state);
+}
+
+/*
+ * Returns 1 if the local variable symbol must live on the heap because an
+ * escaping closure holds a pointer to it.
+ */
+static int
+needs_cell(const char *symbol, const CodeGenState *state) {
+    return Escapes_captured(state->escapes, symbol) &&
+        !captured_by_value(symbol, state);
+}
+
+/*
+ * Emit a heap cell for the local variable symbol, which the variable's name
+ * is defined to from then on. If init is nonzero, the cell starts with the
+ * variable's current value.
+ */
+static void
+codeGenCell(const char *symbol,
+    const Type *type,
+    int init,
+    FILE *out,
+    const CodeGenState *state) {
+    const char *var = intern_mangled(symbol);
+    char *cell = safe_asprintf("%s_cell", var);
+    char *typeName = type->codeGen(type, NULL);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "%s *%s;\n", typeName, cell);
+    free(typeName);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "if (NULL == (%s = malloc(sizeof(*%s)))) {\n", cell, cell);
+    fprintf(out, "%*s", (state->indent + 1) * 4, "");
+    fprintf(out, "ERROR(\"malloc\");\n");
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "}\n");
+    if (init) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "*%s = %s;\n", cell, var);
+    }
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "#define %s (*%s)\n", var, cell);
+    free(cell);
+}
+
+int
+codeGenLocal(const char *symbol,
+    const Type *type,
+    FILE *out,
+    const CodeGenState *state) {
+    if (needs_cell(symbol, state)) {
+        codeGenCell(symbol, type, 0, out, state);
+        return 1;
+    }
+    char *typeName = type->codeGen(type, intern_mangled(symbol));
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "%s;\n", typeName);
+    free(typeName);
+    return 0;
+}
+
+/*
+ * Returns the type of a symbol captured by the function, which must be in
+ * the scope that the function is defined in.
+ */
+static Type *
+env_type(const ASTFunc *ast, const char *symbol) {
+    Type *type;
+    if (Scope_get(ast->symbols, &symbol, sizeof(symbol), &type)) {
+        print_ICE("captured symbol \"%s\" is not in scope\n", symbol);
+        exit(EXIT_FAILURE);
+    }
+    return type;
+}
+
+static void
+codeGenBody(const ASTFunc *ast,
+    const char *name,
+    FILE *out,
+    struct CodeGenState *state) {
+    Vector *cells = Vector(); // Vector<interned char*>
+    Iterator *it = Map_iterator(ast->locals);
     while (it->hasNext(it)) {
         MapIterData data = it->next(it);
-        char *symbol = data.key;
-        size_t len = data.len;
+        const char *symbol = *(char **)data.key;
         Type *type;
-        Map_get(ast->symbols, symbol, len, &type);
-        char *name = safe_asprintf("var_%.*s", (int)len, symbol);
-        char *typeName = type->codeGen(type, NULL);
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out,
-            "#define %s (*(%s*)env.env[%d])\n",
-            name,
-            typeName,
-            envID++);
-        free(name);
-        free(typeName);
+        if (Scope_getLocal(ast->symbols, data.key, data.len, &type)) {
+            // Declared by the block of the control flow statement it is in.
+            continue;
+        }
+        if (codeGenLocal(symbol, type, out, state)) {
+            Vector_append(cells, (char *)symbol);
+        }
     }
     it->delete(it);
-
     size_t nargs = Vector_size(ast->args);
-    int argi = 0;
     for (size_t i = 0; i < nargs; i++) {
         struct Field *arg = Vector_get(ast->args, i);
         size_t nnames = Vector_size(arg->names);
         for (size_t j = 0; j < nnames; j++) {
-            char *name = Vector_get(arg->names, j);
-            char *ident = safe_asprintf("var_%s", name);
-            char *typeName = arg->type->codeGen(arg->type, ident);
-            free(ident);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "%s = ", typeName);
-            if (TYPE_FUNC == arg->type->type) {
-                if (!arg->type->isRef) {
-                    fprintf(out, "*");
-                }
-                fprintf(out, "(closure*)");
+            char *symbol = Vector_get(arg->names, j);
+            if (needs_cell(symbol, state)) {
+                Type *type;
+                Scope_get(ast->symbols, &symbol, sizeof(symbol), &type);
+                codeGenCell(symbol, type, 1, out, state);
+                Vector_append(cells, symbol);
             }
-            fprintf(out, "args[%d];\n", argi++);
+        }
+    }
+
+    struct FuncType *func = (struct FuncType *)ast->super.type;
+    fprintf(out, "%*s", state->indent * 4, "");
+    if (0 < env_size(func, state)) {
+        fprintf(out, "struct env_%s *capture = env;\n", name);
+    } else {
+        fprintf(out, "(void)env;\n");
+    }
+    it = Map_iterator(func->env);
+    while (it->hasNext(it)) {
+        MapIterData data = it->next(it);
+        const char *symbol = *(char **)data.key;
+        if (!in_env(symbol, state)) {
+            continue;
+        }
+        const char *var = intern_mangled(symbol);
+        fprintf(out, "%*s", state->indent * 4, "");
+        if (captured_by_value(symbol, state)) {
+            Type *type = env_type(ast, symbol);
+            char *typeName = type->codeGen(type, var);
+            fprintf(out, "%s = capture->%s;\n", typeName, var);
             free(typeName);
+        } else {
+            fprintf(out, "#define %s (*capture->%s)\n", var, var);
         }
     }
+    it->delete(it);
+
     fprintf(out, "\n");
 
     size_t nstmts = Vector_size(ast->stmts);
     for (size_t i = 0; i < nstmts; i++) {
         AST *stmt = Vector_get(ast->stmts, i);
+        state->prev = 0 == i
+            ? NULL
+            : Vector_get(ast->stmts, i - 1);
+        state->stmt = stmt;
         char *code = stmt->codeGen(stmt, out, state);
         free(code);
     }
     it = Map_iterator(func->env);
     while (it->hasNext(it)) {
         MapIterData data = it->next(it);
-        char *symbol = data.key;
-        size_t len = data.len;
-        char *name = safe_asprintf("var_%.*s", (int)len, symbol);
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "#undef %s\n", name);
-        free(name);
+        const char *symbol = *(char **)data.key;
+        if (!captured_by_value(symbol, state)) {
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "#undef %s\n", intern_mangled(symbol));
+        }
     }
     it->delete(it);
+    size_t ncells = Vector_size(cells);
+    for (size_t i = 0; i < ncells; i++) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "#undef %s\n",
+            intern_mangled(Vector_get(cells, i)));
+    }
+    delete_Vector(cells, NULL);
+}
+
+/*
+ * Returns the prototype of a function, which takes the closure's environment
+ * and then each argument as a typed parameter. It has the type that its
+ * closure's fn points to.
+ */
+static char *
+signature(const ASTFunc *ast, const char *name) {
+    const struct FuncType *func = (const struct FuncType *)ast->super.type;
+    char *retName = TYPE_NONE == func->ret_type->type
+        ? safe_strdup("void")
+        : func->ret_type->codeGen(func->ret_type, NULL);
+    dstring str = dstring(retName);
+    free(retName);
+    vappend_str(&str, "\n%s(void *env", name);
+    size_t nargs = Vector_size(ast->args);
+    for (size_t i = 0; i < nargs; i++) {
+        struct Field *arg = Vector_get(ast->args, i);
+        size_t nnames = Vector_size(arg->names);
+        for (size_t j = 0; j < nnames; j++) {
+            char *argName = Vector_get(arg->names, j);
+            char *typeName =
+                arg->type->codeGen(arg->type, intern_mangled(argName));
+            vappend_str(&str, ", %s", typeName);
+            free(typeName);
+        }
+    }
+    append_str(&str, ")");
+    return str.str;
+}
+
+void
+codeGenFuncDecl(void *this,
+    const char *name,
+    FILE *out,
+    const CodeGenState *state) {
+    const ASTFunc *ast = this;
+    const struct FuncType *func = (const struct FuncType *)ast->super.type;
+    if (0 < env_size(func, state)) {
+        fprintf(out, "struct env_%s {\n", name);
+        Iterator *it = Map_iterator(func->env);
+        while (it->hasNext(it)) {
+            MapIterData data = it->next(it);
+            const char *symbol = *(char **)data.key;
+            if (!in_env(symbol, state)) {
+                continue;
+            }
+            Type *type = env_type(ast, symbol);
+            char *typeName = type->codeGen(type, NULL);
+            fprintf(out,
+                "    %s%s%s;\n",
+                typeName,
+                captured_by_value(symbol, state)
+                    ? " "
+                    : " *",
+                intern_mangled(symbol));
+            free(typeName);
+        }
+        it->delete(it);
+        fprintf(out, "};\n");
+    }
+    char *sig = signature(ast, name);
+    fprintf(out, "%s;\n", sig);
+    free(sig);
+}
+
+void
+codeGenFunc(void *this, const char *name, FILE *out, CodeGenState *state) {
+    const ASTFunc *ast = this;
+    char *sig = signature(ast, name);
+    fprintf(out, "%s {\n", sig);
+    free(sig);
+    state->indent++;
+    codeGenBody(ast, name, out, state);
+    state->indent--;
+    fprintf(out, "}\n");
+    fprintf(out, "\n");
+}
+
+static AST *
+fold(void *this, FoldState *state) {
+    ASTFunc *ast = this;
+    fold_vector(ast->stmts, state);
+    return this;
 }
 
 static char *
 codeGen(void *this, UNUSED FILE *out, CodeGenState *state) {
     ASTFunc *ast = this;
     struct FuncType *func = (struct FuncType *)ast->super.type;
-    char *tmp = safe_asprintf("temp%d", state->tempCount);
-    state->tempCount++;
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "void *%s[] = {", tmp);
-    Iterator *it = Map_iterator(func->env);
-    char *sep = "";
-    while (it->hasNext(it)) {
-        MapIterData data = it->next(it);
-        char *symbol = data.key;
-        size_t len = data.len;
-        fprintf(out, " %s&var_%.*s", sep, (int)len, symbol);
-        sep = ",";
-    }
-    fprintf(out, " };\n");
-    it->delete(it);
     char *name;
     Map_get(state->funcIDs, &func, sizeof(func), &name);
-    char *ret = safe_asprintf("(closure){ %s, %s }", name, tmp);
-    free(tmp);
-    return ret;
-}
-
-static void
-delete(void *this) {
-    ASTFunc *ast = this;
-    delete_Vector(ast->generics, free);
-    delete_Vector(ast->args, (VEC_DELETE_FUNC)delete_field);
-    delete_type(ast->ret_type);
-    delete_Vector(ast->stmts, (VEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
-    }
-    if (NULL != ast->symbols) {
-        delete_Map(ast->symbols, (MAP_DELETE_FUNC)delete_type);
-    }
-    if (NULL != ast->locals) {
-        delete_Map(ast->locals, NULL);
+    Map_put(state->reached, &func, sizeof(func), NULL, NULL);
+    char *env;
+    if (0 == env_size(func, state)) {
+        env = safe_strdup("NULL");
+    } else {
+        char *tmp = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        int heap = Escapes_escapes(state->escapes, this);
+        fprintf(out, "%*s", state->indent * 4, "");
+        if (heap) {
+            // The closure may outlive this frame, so its env can't.
+            fprintf(out, "struct env_%s *%s;\n", name, tmp);
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out,
+                "if (NULL == (%s = malloc(sizeof(*%s)))) {\n",
+                tmp,
+                tmp);
+            fprintf(out, "%*s", (state->indent + 1) * 4, "");
+            fprintf(out, "ERROR(\"malloc\");\n");
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "}\n");
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "*%s = (struct env_%s){", tmp, name);
+        } else {
+            fprintf(out, "struct env_%s %s = {", name, tmp);
+        }
+        Iterator *it = Map_iterator(func->env);
+        char *sep = "";
+        while (it->hasNext(it)) {
+            MapIterData data = it->next(it);
+            const char *symbol = *(char **)data.key;
+            if (!in_env(symbol, state)) {
+                continue;
+            }
+            fprintf(out,
+                "%s %s%s",
+                sep,
+                captured_by_value(symbol, state)
+                    ? ""
+                    : "&",
+                intern_mangled(symbol));
+            sep = ",";
+        }
+        fprintf(out, " };\n");
+        it->delete(it);
+        env = heap
+            ? safe_strdup(tmp)
+            : safe_asprintf("&%s", tmp);
+        free(tmp);
     }
-    free(this);
+    char *typeName = func->super.codeGen(func, NULL);
+    char *ret = safe_asprintf("(%s){ %s, %s }", typeName, name, env);
+    free(typeName);
+    free(env);
+    return ret;
 }
 
 AST *
@@ -299,13 +547,13 @@ new_ASTFunc(YYLTYPE loc,
     Vector *stmts) {
     ASTFunc *func = NULL;
 
-    func = safe_malloc(sizeof(*func));
+    func = arena_malloc(sizeof(*func));
     *func = (ASTFunc){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
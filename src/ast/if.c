@@ -1,10 +1,13 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
 
 typedef struct ASTIf ASTIf;
 
@@ -16,8 +19,8 @@ struct ASTIf {
     Vector *trueStmts;  // Vector<AST*>
     Vector *falseStmts; // Vector<AST*>
     // NULL until type checker is executed:
-    Map *trueSymbols;
-    Map *falseSymbols;
+    Scope *trueSymbols;
+    Scope *falseSymbols;
 };
 
 static void
@@ -57,11 +60,11 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     } else {
         const struct ObjectType *object = (const struct ObjectType *)condType;
         const struct ClassType *class = object->class;
-        const char *fieldName = "=>";
+        const char *fieldName = intern("=>");
         Type *fieldType;
         if (Map_get(class->fieldTypes,
-            fieldName,
-            strlen(fieldName),
+            &fieldName,
+            sizeof(fieldName),
             &fieldType)) {
             char *typeName = condType->toString(condType);
             print_code_error(stderr,
@@ -80,7 +83,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
                     *ret = (const struct ObjectType *)func->ret_type;
                 if (TYPE_OBJECT == func->ret_type->type &&
                     !ret->class->super.compare(ret->class,
-                        state->builtins[BUILTIN_BOOL],
+                        BuiltinClass(BUILTIN_BOOL, state),
                         state)) {
                     // Found right cast
                     found = 1;
@@ -99,7 +102,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
             }
         }
     }
-    Map *prevSymbols = state->symbols;
+    Scope *prevSymbols = state->symbols;
     Map *prevNewInit = state->newInitSymbols;
     Type *prevRetType = state->retType;
     size_t nTrue = Vector_size(ast->trueStmts);
@@ -108,7 +111,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
 
     // True Branch
     if (nTrue != 0) {
-        ast->trueSymbols = copy_Map(prevSymbols, (MAP_COPY_FUNC)copy_type);
+        ast->trueSymbols = Scope(prevSymbols);
+        Vector_append(state->scopes, ast->trueSymbols);
         state->symbols = ast->trueSymbols;
         state->retType = NULL;
     }
@@ -124,7 +128,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
 
     // False Branch
     if (nFalse != 0) {
-        ast->falseSymbols = copy_Map(prevSymbols, (MAP_COPY_FUNC)copy_type);
+        ast->falseSymbols = Scope(prevSymbols);
+        Vector_append(state->scopes, ast->falseSymbols);
         state->symbols = ast->falseSymbols;
         state->retType = NULL;
     }
@@ -151,10 +156,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     Iterator *it = Map_iterator(trueNewInit);
     while (it->hasNext(it)) {
         MapIterData symbol = it->next(it);
-        Type *type;
-        if (!Map_get(state->symbols, symbol.key, symbol.len, &type) &&
-            Map_contains(falseNewInit, symbol.key, symbol.len)) {
-            type->init = 1;
+        if (Map_contains(falseNewInit, symbol.key, symbol.len) &&
+            !InitSymbol(state->symbols, symbol.key, symbol.len)) {
             if (NULL != state->newInitSymbols) {
                 Map_put(state->newInitSymbols,
                     symbol.key,
@@ -171,33 +174,44 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     return status;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* IF NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTIf *ast = this;
+    ast->cond = ast->cond->fold(ast->cond, state);
+    fold_vector(ast->trueStmts, state);
+    fold_vector(ast->falseStmts, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTIf *ast = this;
-    delete_AST(ast->cond);
-    delete_Vector(ast->trueStmts, (VEC_DELETE_FUNC)delete_AST);
-    delete_Vector(ast->falseStmts, (VEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->trueSymbols) {
-        delete_Map(ast->trueSymbols, (MAP_DELETE_FUNC)delete_type);
-    }
-    if (NULL != ast->falseSymbols) {
-        delete_Map(ast->falseSymbols, (MAP_DELETE_FUNC)delete_type);
+    char *cond = codeGenCondition(ast->cond, out, state);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "if (%s) {\n", cond);
+    free(cond);
+    state->indent++;
+    codeGenBlock(ast->trueSymbols, ast->trueStmts, out, state);
+    state->indent--;
+    if (0 < Vector_size(ast->falseStmts)) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "} else {\n");
+        state->indent++;
+        codeGenBlock(ast->falseSymbols, ast->falseStmts, out, state);
+        state->indent--;
     }
-    free(this);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "}\n");
+    return NULL;
 }
 
 AST *
 new_ASTIf(YYLTYPE loc, AST *cond, Vector *trueStmts, Vector *falseStmts) {
     ASTIf *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTIf){
-        { json, getType, codeGen, delete, loc, NULL },
+        { json, getType, fold, codeGen, loc, NULL },
         cond,
         trueStmts,
         falseStmts,
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -42,31 +43,29 @@ getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
     return 1;
 }
 
+static AST *
+fold(void *this, FoldState *state) {
+    ASTImpl *ast = this;
+    fold_vector(ast->stmts, state);
+    return this;
+}
+
 static char *
 codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     return safe_strdup("/* IMPL NOT IMPLEMENTED */");
 }
 
-static void
-delete(void *this) {
-    ASTImpl *ast = this;
-    free(ast->name);
-    delete_Vector(ast->generics, free);
-    delete_Vector(ast->stmts, (VEC_DELETE_FUNC)delete_AST);
-    free(this);
-}
-
 AST *
 new_ASTImpl(YYLTYPE loc, char *name, Vector *generics, Vector *stmts) {
     ASTImpl *impl = NULL;
 
-    impl = safe_malloc(sizeof(*impl));
+    impl = arena_malloc(sizeof(*impl));
     *impl = (ASTImpl){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
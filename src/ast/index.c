@@ -1,9 +1,11 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
+#include "map.h"
 
 typedef struct ASTIndex ASTIndex;
 
@@ -29,40 +31,126 @@ json(const void *this, FILE *out, int indent) {
 }
 
 static int
-getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
-    // TODO: array indexing
+getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTIndex *ast = this;
-    print_code_error(stderr,
-        ast->super.loc,
-        "%s",
-        "index type checker not implemented");
-    return 1;
+    Type *type = NULL, *indexType = NULL;
+    if (ast->expr->getType(ast->expr, state, &type) ||
+        ast->index->getType(ast->index, state, &indexType)) {
+        return 1;
+    }
+    if (TYPE_ARRAY != type->type) {
+        char *typeName = type->toString(type);
+        print_code_error(stderr,
+            ast->super.loc,
+            "index operator used on non-indexable object with type \"%s\"",
+            typeName);
+        free(typeName);
+        return 1;
+    }
+    if (TypeCompare(BuiltinType(BUILTIN_INT, state), indexType, state)) {
+        char *typeName = indexType->toString(indexType);
+        print_code_error(stderr,
+            ast->index->loc,
+            "array indexed with non-int type \"%s\"",
+            typeName);
+        free(typeName);
+        return 1;
+    }
+    const struct ArrayType *array = (const struct ArrayType *)type;
+    *typeptr = ast->super.type = array->type;
+    return 0;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* INDEX NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTIndex *ast = this;
+    ast->expr = ast->expr->fold(ast->expr, state);
+    ast->index = ast->index->fold(ast->index, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+/*
+ * Returns 1 if index is known to be in the bounds of the array expr.
+ */
+static int
+in_bounds(const AST *expr, const AST *index, const CodeGenState *state) {
+    const char *name = ASTVariable_name(expr);
+    AST *value;
+    long long length, val;
+    if (NULL == name ||
+        Map_get(state->bindings, &name, sizeof(name), &value) ||
+        NULL == value ||
+        ASTArray_length(value, &length)) {
+        return 0;
+    }
+    if (!ASTInt_value(index, &val)) {
+        return 0 <= val && val < length;
+    }
+    const char *counter = ASTVariable_name(index);
+    long long *bound;
+    return NULL != counter &&
+        !Map_get(state->bounds, &counter, sizeof(counter), &bound) &&
+        *bound <= length;
+}
+
+char *
+codeGenIndex(AST *expr, AST *index, FILE *out, CodeGenState *state) {
+    long long val;
+    int simple = NULL != ASTVariable_name(index) || !ASTInt_value(index, &val);
+    char *array = expr->codeGen(expr, out, state);
+    if (NULL == ASTVariable_name(expr) || !simple) {
+        // Evaluate the array before the index's statements.
+        char *tmp = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "array %s = %s;\n", tmp, array);
+        free(array);
+        array = tmp;
+    }
+    char *i = index->codeGen(index, out, state);
+    if (!simple) {
+        char *tmp = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "int64_t %s = %s;\n", tmp, i);
+        free(i);
+        i = tmp;
+    }
+    if (!in_bounds(expr, index, state)) {
+        // Negative indices wrap around to above any length.
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "if ((uint64_t)%s >= (%s)->length) {\n", i, array);
+        fprintf(out, "%*s", (state->indent + 1) * 4, "");
+        fprintf(out, "array_index_error(%s, (%s)->length);\n", i, array);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    const Type *elem = ((const struct ArrayType *)expr->type)->type;
+    char *typeName = elem->codeGen(elem, NULL);
+    char *code = safe_asprintf("((%s *)(%s)->data)[%s]", typeName, array, i);
+    free(typeName);
+    free(array);
+    free(i);
+    return code;
+}
+
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTIndex *ast = this;
-    delete_AST(ast->expr);
-    delete_AST(ast->index);
-    free(this);
+    return codeGenIndex(ast->expr, ast->index, out, state);
 }
 
 AST *
 new_ASTIndex(YYLTYPE loc, AST *expr, AST *index) {
     ASTIndex *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTIndex){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
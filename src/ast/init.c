@@ -1,10 +1,12 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
 
 typedef struct ASTInit ASTInit;
 
@@ -41,9 +43,12 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     // ClassTypeVerify() assumes this fully checks the validity of the class.
     ASTInit *ast = this;
     Type *classType = NULL;
-    size_t ngen, len = strlen(ast->name);
+    size_t ngen;
 
-    if (Map_get(state->symbols, ast->name, len, &classType)) {
+    if (Scope_get(state->symbols,
+        &ast->name,
+        sizeof(ast->name),
+        &classType)) {
         print_code_error(stderr,
             ast->super.loc,
             "unrecognized type name \"%s\"",
@@ -86,7 +91,7 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     if (nctors == 0 && ngiven == 0) {
         // Implicit default constructor
         *typeptr = ast->super.type =
-            ObjectType(ast->super.loc, safe_strdup(ast->name), Vector());
+            ObjectType(ast->super.loc, ast->name, Vector());
         char *msg;
         if (ast->super.type->verify(ast->super.type, state, &msg)) {
             print_code_error(stderr, ast->super.type->loc, "%s", msg);
@@ -110,9 +115,8 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
                 }
             }
             if (valid) {
-                *typeptr = ast->super.type = ObjectType(ast->super.loc,
-                    safe_strdup(ast->name),
-                    Vector());
+                *typeptr = ast->super.type =
+                    ObjectType(ast->super.loc, ast->name, Vector());
                 char *msg;
                 if (ast->super.type->verify(ast->super.type, state, &msg)) {
                     print_code_error(stderr, ast->super.type->loc, "%s", msg);
@@ -134,38 +138,40 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return 1;
 }
 
-static char *
-codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
+static AST *
+fold(void *this, FoldState *state) {
     ASTInit *ast = this;
-    return safe_asprintf("CALL(var_%s, 0)", ast->name);
+    fold_vector(ast->args, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+static char *
+codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     ASTInit *ast = this;
-    free(ast->name);
-    delete_Vector(ast->generics, free);
-    delete_Vector(ast->args, (VEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->argTypes) {
-        delete_Vector(ast->argTypes, (VEC_DELETE_FUNC)delete_type);
+    const struct ClassType *class =
+        ((const struct ObjectType *)ast->super.type)->class;
+    if (NULL != class->ctype) {
+        // Builtins have no subclasses, so this is always the default value.
+        return safe_asprintf("(%s)0", class->ctype);
     }
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+    if (0 < class->id && class->id <= NUM_BUILTINS) {
+        // Builtins only have the default constructor, see runtime/tlangrt.h.
+        return safe_asprintf("new_%s()", class->name);
     }
-    free(this);
+    return safe_strdup("/* INIT NOT IMPLEMENTED */");
 }
 
 AST *
 new_ASTInit(YYLTYPE loc, char *name, Vector *generics, Vector *args) {
     ASTInit *init = NULL;
 
-    init = safe_malloc(sizeof(*init));
+    init = arena_malloc(sizeof(*init));
     *init = (ASTInit){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -26,47 +27,47 @@ json(const void *this, FILE *out, int indent) {
 static int
 getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTInt *ast = this;
-    char *msg;
-    if (ast->super.type->verify(ast->super.type, state, &msg)) {
-        print_code_error(stderr, ast->super.loc, "%s", msg);
-        free(msg);
-        return 1;
-    }
-    *typeptr = ast->super.type;
+    *typeptr = ast->super.type = BuiltinType(BUILTIN_INT, state);
     return 0;
 }
 
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
+}
+
 static char *
 codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     ASTInt *ast = this;
-    return safe_asprintf("builtin_int(%"
-        PRId64
-        ")", ast->val);
+    if (INT64_MIN == ast->val) {
+        // Folding can wrap around to a value whose magnitude isn't a valid
+        // C literal.
+        return safe_strdup("INT64_MIN");
+    }
+    return safe_asprintf("%" PRId64, ast->val);
 }
 
-static void
-delete(void *this) {
-    ASTInt *ast = this;
-    delete_type(ast->super.type);
-    free(this);
+int
+ASTInt_value(const AST *ast, long long int *val) {
+    if (codeGen != ast->codeGen) {
+        return 1;
+    }
+    *val = ((const ASTInt *)ast)->val;
+    return 0;
 }
 
 AST *
 new_ASTInt(YYLTYPE loc, long long int val) {
     ASTInt *node = NULL;
-    Type *type;
-
-    type = new_ObjectType(loc, safe_strdup("int"), Vector());
-    type->init = 1;
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTInt){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
-            type
+            NULL
         },
         val
     };
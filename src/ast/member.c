@@ -1,9 +1,12 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 #include "map.h"
+#include "intern.h"
+#include "vector.h"
 
 typedef struct ASTMember ASTMember;
 
@@ -28,8 +31,30 @@ json(const void *this, FILE *out, int indent) {
     json_end(out, &indent);
 }
 
+// Operators that builtins implement, either natively if they're unboxed or
+// as methods with a direct entry point.
+static const char *arithmeticOps[] = {
+    "+", "-", "*", "/"
+};
+static const char *assignOps[] = {
+    "+=", "-=", "*=", "/="
+};
+static const char *compareOps[] = {
+    "==", "!=", "<", ">", "<=", ">="
+};
+
 static int
-getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
+is_op(const char *name, const char **ops, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (!strcmp(name, ops[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTMember *ast = this;
     Type *exprType = NULL;
     if (ast->expr->getType(ast->expr, state, &exprType)) {
@@ -47,7 +72,10 @@ getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
     const struct ObjectType *object = (const struct ObjectType *)exprType;
     const struct ClassType *class = object->class;
     Type *fieldType;
-    if (Map_get(class->fieldTypes, ast->name, strlen(ast->name), &fieldType)) {
+    if (Map_get(class->fieldTypes,
+        &ast->name,
+        sizeof(ast->name),
+        &fieldType)) {
         char *typeName = exprType->toString(exprType);
         print_code_error(stderr,
             ast->super.loc,
@@ -57,10 +85,27 @@ getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
         free(typeName);
         return 1;
     }
+    const char *var = ASTVariable_name(ast->expr);
+    size_t nassign = sizeof(assignOps) / sizeof(*assignOps);
+    if (NULL != var && is_op(ast->name, assignOps, nassign)) {
+        // Unboxed receivers are assigned to in place.
+        BindSymbol(state, var, NULL);
+    }
     *typeptr = ast->super.type = copy_type(fieldType);
     return 0;
 }
 
+static AST *
+fold(void *this, FoldState *state) {
+    ASTMember *ast = this;
+    size_t nassign = sizeof(assignOps) / sizeof(*assignOps);
+    if (!is_op(ast->name, assignOps, nassign)) {
+        // The receiver of an assignment has to stay assignable.
+        ast->expr = ast->expr->fold(ast->expr, state);
+    }
+    return this;
+}
+
 static char *
 codeGen(void *this, FILE *out, CodeGenState *state) {
     const ASTMember *ast = this;
@@ -74,17 +119,21 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     free(code);
 
     if (ast->super.type->type == TYPE_FUNC) {
+        Vector_append(state->temps, ast->super.type);
         char *tmpName2 = safe_asprintf("temp%d", state->tempCount);
         state->tempCount++;
         char fieldName[strlen(ast->name) * 2 + 1];
         strident(ast->name, fieldName);
+        char *closureName =
+            ast->super.type->codeGen(ast->super.type, tmpName2);
         fprintf(out, "%*s", state->indent * 4, "");
         fprintf(out,
-            "closure %s = { %s->field_%s, (void*[]){%s} };\n",
-            tmpName2,
+            "%s = { %s->vtable->field_%s, %s };\n",
+            closureName,
             tmpName,
             fieldName,
             tmpName);
+        free(closureName);
         free(tmpName);
         return tmpName2;
     } else {
@@ -96,28 +145,122 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     }
 }
 
-static void
-delete(void *this) {
-    ASTMember *ast = this;
-    delete_AST(ast->expr);
-    free(ast->name);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+char *
+codeGenOperator(AST *expr, Vector *args, FILE *out, CodeGenState *state) {
+    if (codeGen != expr->codeGen || 1 != Vector_size(args)) {
+        return NULL;
+    }
+    const ASTMember *ast = (const ASTMember *)expr;
+    struct Argument *arg = Vector_get(args, 0);
+    if (TYPE_OBJECT != ast->expr->type->type || arg->isRef) {
+        return NULL;
+    }
+    const struct ClassType *class =
+        ((const struct ObjectType *)ast->expr->type)->class;
+    size_t nops = sizeof(arithmeticOps) / sizeof(*arithmeticOps);
+    size_t nassign = sizeof(assignOps) / sizeof(*assignOps);
+    size_t ncompare = sizeof(compareOps) / sizeof(*compareOps);
+    int isAssign = is_op(ast->name, assignOps, nassign);
+    int isArithmetic = is_op(ast->name, arithmeticOps, nops);
+    int isCompare = is_op(ast->name, compareOps, ncompare);
+    if (NULL != class->ctype && isAssign) {
+        // The receiver is assigned to, so use it directly instead of a copy.
+        char *rhs = arg->ast->codeGen(arg->ast, out, state);
+        char *lhs = ast->expr->codeGen(ast->expr, out, state);
+        char *ret = safe_asprintf("(%s %s %s)", lhs, ast->name, rhs);
+        free(lhs);
+        free(rhs);
+        return ret;
+    }
+    int isNative = NULL != class->ctype && (isArithmetic || isCompare);
+    // Builtins have no subclasses, so their methods are known statically.
+    int isMethod = NULL == class->ctype &&
+        (isArithmetic || isAssign || isCompare) &&
+        0 < class->id && class->id <= NUM_BUILTINS;
+    if (!isNative && !isMethod) {
+        return NULL;
+    }
+    // Evaluate the receiver before the argument, like a closure call would.
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    char *lhs = safe_asprintf("temp%d", state->tempCount);
+    state->tempCount++;
+    fprintf(out, "%*s", state->indent * 4, "");
+    if (isNative) {
+        fprintf(out, "%s %s = %s;\n", class->ctype, lhs, code);
+    } else {
+        fprintf(out, "class_%s %s = %s;\n", class->name, lhs, code);
+    }
+    free(code);
+    char *rhs = arg->ast->codeGen(arg->ast, out, state);
+    char *ret;
+    if (isNative) {
+        // Comparisons return a bool, so cast to the return type's ctype.
+        const struct FuncType *func = (const struct FuncType *)ast->super.type;
+        const struct ClassType *retClass =
+            ((const struct ObjectType *)func->ret_type)->class;
+        ret = safe_asprintf("(%s)(%s %s %s)",
+            retClass->ctype,
+            lhs,
+            ast->name,
+            rhs);
+    } else {
+        char fieldName[strlen(ast->name) * 2 + 1];
+        strident(ast->name, fieldName);
+        ret = safe_asprintf("class_%s_field_%s_direct(%s, %s)",
+            class->name,
+            fieldName,
+            lhs,
+            rhs);
+    }
+    free(lhs);
+    free(rhs);
+    return ret;
+}
+
+int
+matchOperator(const AST *expr,
+    const Vector *args,
+    const AST **lhs,
+    const char **op,
+    const AST **rhs) {
+    if (codeGen != expr->codeGen || 1 != Vector_size(args)) {
+        return 1;
+    }
+    const ASTMember *member = (const ASTMember *)expr;
+    const struct Argument *arg = Vector_get(args, 0);
+    if (arg->isRef) {
+        return 1;
+    }
+    *lhs = member->expr;
+    *op = member->name;
+    *rhs = arg->ast;
+    return 0;
+}
+
+AST *
+foldOperator(const AST *ast, AST *expr, Vector *args) {
+    if (codeGen != expr->codeGen || 1 != Vector_size(args)) {
+        return NULL;
+    }
+    const ASTMember *member = (const ASTMember *)expr;
+    const struct Argument *arg = Vector_get(args, 0);
+    if (arg->isRef) {
+        return NULL;
     }
-    free(this);
+    return foldBuiltinOperator(ast, member->name, member->expr, arg->ast);
 }
 
 AST *
 new_ASTMember(YYLTYPE loc, AST *expr, char *name) {
     ASTMember *member = NULL;
 
-    member = safe_malloc(sizeof(*member));
+    member = arena_malloc(sizeof(*member));
     *member = (ASTMember){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
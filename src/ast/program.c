@@ -1,21 +1,32 @@
 #include "ast.h"
 #include <stdlib.h>
+#include <math.h>
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
 #include "json.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
 #include "types.h"
+#include "subtype.h"
+#include "overload.h"
+#include "escape.h"
+#include "dynamic_string.h"
 
 typedef struct ASTProgram ASTProgram;
 
 struct ASTProgram {
     AST super;
     Vector *stmts;     // Vector<AST*>
-    Map *symbols;      // Map<char*, Type*>
+    Scope *symbols;    // Scope<char*, Type*>
     Vector *classes;   // Vector<const struct ClassType*>
     Vector *functions; // Vector<const struct FuncType*>
-    Map *compare;      // Map<Type**, Map<Type**, int>>
+    Vector *scopes;    // Vector<Scope*>
+    SubtypeMatrix *subtypes;
+    Map *bindings;     // Map<interned char*, AST*>
+    Escapes *escapes;
 };
 
 static void
@@ -61,61 +72,117 @@ struct Operator {
     }
 };
 
+enum CMPTYPE {
+    EQUALITY = 1 << 0, ORDERING = 1 << 1
+};
+
+struct Comparison {
+    enum CMPTYPE type;
+    const char *op;
+} comparisons[] = {
+    {
+        EQUALITY,
+        "=="
+    },
+    {
+        EQUALITY,
+        "!="
+    },
+    {
+        ORDERING,
+        "<"
+    },
+    {
+        ORDERING,
+        ">"
+    },
+    {
+        ORDERING,
+        "<="
+    },
+    {
+        ORDERING,
+        ">="
+    }
+};
+
+/*
+ * The builtin classes, which are defined in the runtime library. See
+ * runtime/tlangrt.h.
+ */
 struct Builtin {
     enum BUILTIN_TYPE type;
     char *name;
     char *ctype;
-    char *fmt;
     enum OPTYPE operators;
+    enum CMPTYPE comparisons; // Comparisons that return a bool
     enum BUILTIN_TYPE casts;
+    unsigned char unboxed : 1; // Stored as a raw ctype instead of a class_*
 } builtins[] = {
     {
         BUILTIN_INT,
         "int",
         "int64_t",
-        "%\" PRId64 \"",
         PLUS | MINUS | TIMES | DIVIDE,
-        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING
+        EQUALITY | ORDERING,
+        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING,
+        1
     },
     {
         BUILTIN_BOOL,
         "bool",
         "unsigned char",
-        "%d",
         0,
-        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING
+        EQUALITY,
+        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING,
+        1
     },
     {
         BUILTIN_DOUBLE,
         "double",
         "double",
-        "%f",
         PLUS | MINUS | TIMES | DIVIDE,
-        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING
+        EQUALITY | ORDERING,
+        BUILTIN_INT | BUILTIN_BOOL | BUILTIN_DOUBLE | BUILTIN_STRING,
+        1
     },
     {
         BUILTIN_STRING,
         "string",
         "char*",
-        "%s",
         PLUS,
-        BUILTIN_STRING
+        EQUALITY,
+        BUILTIN_STRING,
+        0
     },
 };
 
 static TypeCheckState
-addBuiltins(Map *symbols, Vector *classes, Vector *functions, Map *compare) {
+addBuiltins(Scope *symbols,
+    Vector *classes,
+    Vector *functions,
+    Vector *scopes,
+    Vector *typeCases,
+    SubtypeMatrix *subtypes,
+    Map *bindings,
+    Escapes *escapes) {
     TypeCheckState state = {
         symbols,
         NULL,
         NULL,
         NULL,
+        NULL,
         classes,
         functions,
+        scopes,
+        typeCases,
         {
             NULL
         },
-        compare,
+        subtypes,
+        bindings,
+        escapes,
+        symbols,
         NULL,
         NULL
     };
@@ -130,11 +197,14 @@ addBuiltins(Map *symbols, Vector *classes, Vector *functions, Map *compare) {
         Vector *ctors = Vector();
         Type *type = ClassType(loc, gen, supers, fields, ctors);
         type->init = 1;
-        Map_put(state.symbols, builtin.name, strlen(builtin.name), type, NULL);
+        char *name = intern(builtin.name);
+        Scope_put(state.symbols, &name, sizeof(name), type, NULL);
         struct ClassType *class = (struct ClassType *)type;
-        class->name = safe_strdup(builtin.name);
+        class->name = name;
+        if (builtin.unboxed) {
+            class->ctype = builtin.ctype;
+        }
         state.builtins[i] = class;
-        Map_put(compare, &class, sizeof(class), Map(), NULL);
         char *msg;
         if (type->verify(type, &state, &msg)) {
             print_ICE(msg);
@@ -147,124 +217,125 @@ addBuiltins(Map *symbols, Vector *classes, Vector *functions, Map *compare) {
     for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
         struct Builtin builtin = builtins[i];
         const struct ClassType *class = state.builtins[i];
+        char *name = class->name;
         for (size_t j = 0; j < sizeof(builtins) / sizeof(*builtins); j++) {
             struct Builtin cast = builtins[j];
             if (builtin.casts & cast.type) {
-                Type *retType =
-                    ObjectType(loc, safe_strdup(cast.name), Vector());
+                Type *retType = ObjectType(loc, intern(cast.name), Vector());
                 retType->verify(retType, &state, NULL);
                 Type *fieldType = FuncType(loc, Vector(), Vector(), retType);
-                char *fieldName = "=>";
-                AddSymbol(class->fieldTypes,
-                    fieldName,
-                    strlen(fieldName),
-                    fieldType,
-                    0,
-                    &state,
-                    NULL);
+                char *fieldName = intern("=>");
+                size_t len = sizeof(fieldName);
+                struct FuncType *prevType;
+                // Overload the cast operator for each castable type
+                if (Map_get(class->fieldTypes, &fieldName, len, &prevType)) {
+                    Map_put(class->fieldTypes,
+                        &fieldName,
+                        len,
+                        fieldType,
+                        NULL);
+                } else {
+                    AddOverload(prevType, (struct FuncType *)fieldType);
+                }
             }
         }
         for (size_t j = 0; j < sizeof(operators) / sizeof(*operators); j++) {
             if (builtin.operators & operators[j].type) {
                 {
-                    Type *retType =
-                        ObjectType(loc, safe_strdup(builtin.name), Vector());
-                    Type *argType =
-                        ObjectType(loc, safe_strdup(builtin.name), Vector());
+                    Type *retType = ObjectType(loc, name, Vector());
+                    Type *argType = ObjectType(loc, name, Vector());
                     retType->verify(retType, &state, NULL);
                     argType->verify(argType, &state, NULL);
                     Vector *args = init_Vector(argType);
                     Type *fieldType = FuncType(loc, Vector(), args, retType);
                     //Vector_append(state.functions, fieldType);
+                    char *fieldName = intern(operators[j].op);
                     Map_put(class->fieldTypes,
-                        operators[j].op,
-                        strlen(operators[j].op),
+                        &fieldName,
+                        sizeof(fieldName),
                         fieldType,
                         NULL);
                 }
                 {
-                    Type *retType =
-                        ObjectType(loc, safe_strdup(builtin.name), Vector());
-                    Type *argType =
-                        ObjectType(loc, safe_strdup(builtin.name), Vector());
+                    Type *retType = ObjectType(loc, name, Vector());
+                    Type *argType = ObjectType(loc, name, Vector());
                     retType->verify(retType, &state, NULL);
                     argType->verify(argType, &state, NULL);
                     Vector *args = init_Vector(argType);
                     Type *fieldType = FuncType(loc, Vector(), args, retType);
                     //Vector_append(state.functions, fieldType);
+                    char *fieldName = intern(operators[j].assign_op);
                     Map_put(class->fieldTypes,
-                        operators[j].assign_op,
-                        strlen(operators[j].assign_op),
+                        &fieldName,
+                        sizeof(fieldName),
                         fieldType,
                         NULL);
                 }
             }
         }
-        {
-            Type *retType =
-                ObjectType(loc, safe_strdup(builtin.name), Vector());
-            Type *argType =
-                ObjectType(loc, safe_strdup(builtin.name), Vector());
-            retType->verify(retType, &state, NULL);
-            argType->verify(argType, &state, NULL);
-            Vector *args = init_Vector(argType);
-            Type *fieldType = FuncType(loc, Vector(), args, retType);
-            //Vector_append(state.functions, fieldType);
-            char *fieldName = "==";
-            Map_put(class->fieldTypes,
-                fieldName,
-                strlen(fieldName),
-                fieldType,
-                NULL);
+        for (size_t j = 0; j < sizeof(comparisons) / sizeof(*comparisons);
+            j++) {
+            if (builtin.comparisons & comparisons[j].type) {
+                Type *retType = ObjectType(loc, intern("bool"), Vector());
+                Type *argType = ObjectType(loc, name, Vector());
+                retType->verify(retType, &state, NULL);
+                argType->verify(argType, &state, NULL);
+                Vector *args = init_Vector(argType);
+                Type *fieldType = FuncType(loc, Vector(), args, retType);
+                char *fieldName = intern(comparisons[j].op);
+                Map_put(class->fieldTypes,
+                    &fieldName,
+                    sizeof(fieldName),
+                    fieldType,
+                    NULL);
+            }
         }
+        index_ClassType((struct ClassType *)class);
     }
     return state;
 }
 
-static void
-json_typePtr(const Type **typePtr, UNUSED size_t size, FILE *out) {
-    char *str = (*typePtr)->toString(*typePtr);
-    json_label(str, out);
-    free(str);
-}
-
-static void
-json_compare(const Map *compare, FILE *out, int indent) {
-    json_Map(compare,
-        (JSON_KEY_FUNC)json_typePtr,
-        (JSON_VALUE_FUNC)json_empty,
-        out,
-        indent);
-}
-
 static int
 getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
     ASTProgram *ast = this;
     size_t n;
     int status = 0;
+    Vector *typeCases = Vector();
 
-    TypeCheckState new_state =
-        addBuiltins(ast->symbols, ast->classes, ast->functions, ast->compare);
+    TypeCheckState new_state = addBuiltins(ast->symbols,
+        ast->classes,
+        ast->functions,
+        ast->scopes,
+        typeCases,
+        ast->subtypes,
+        ast->bindings,
+        ast->escapes);
     n = Vector_size(ast->stmts);
     for (size_t i = 0; i < n; i++) {
         AST *stmt = Vector_get(ast->stmts, i);
         Type *type;
         status = stmt->getType(stmt, &new_state, &type) || status;
     }
+    // Every class is known now, so the subtypes of the classes that type
+    // cases test for are complete.
+    n = Vector_size(typeCases);
+    for (size_t i = 0; !status && i < n; i++) {
+        SubtypeMatrix_subtypes(ast->subtypes,
+            Vector_get(typeCases, i),
+            ast->classes,
+            &new_state);
+    }
+    delete_Vector(typeCases, NULL);
     if (!status) {
         fprintf(stdout, "Symbol Table:\n");
-        json_Map(ast->symbols,
-            (JSON_KEY_FUNC)json_nlabel,
+        json_Scope(ast->symbols,
+            json_symbol,
             (JSON_VALUE_FUNC)json_type,
             stdout,
             0);
         fprintf(stdout, "\n");
         fprintf(stdout, "Class Hierarchy:\n");
-        json_Map(ast->compare,
-            (JSON_KEY_FUNC)json_typePtr,
-            (JSON_VALUE_FUNC)json_compare,
-            stdout,
-            0);
+        json_SubtypeMatrix(ast->subtypes, ast->classes, stdout, 0);
         fprintf(stdout, "\n");
         fprintf(stdout, "Functions:\n");
         json_vector(ast->functions, (JSON_VALUE_FUNC)json_type, stdout, 0);
@@ -272,6 +343,294 @@ getType(void *this, UNUSED TypeCheckState *state, UNUSED Type **typeptr) {
     return status;
 }
 
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    ASTProgram *ast = this;
+    FoldState newState = (FoldState){
+        ast->bindings
+    };
+    fold_vector(ast->stmts, &newState);
+    return this;
+}
+
+// The value of a literal of a builtin.
+union Literal {
+    long long int i;
+    double d;
+    int b;
+    const char *s;
+};
+
+static const struct Builtin *
+find_builtin(enum BUILTIN_TYPE type) {
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
+        if (type == builtins[i].type) {
+            return &builtins[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the builtin that ast is a literal of and stores its value in val,
+ * or returns NULL if ast isn't a literal.
+ */
+static const struct Builtin *
+literal_builtin(const AST *ast, union Literal *val) {
+    if (!ASTInt_value(ast, &val->i)) {
+        return find_builtin(BUILTIN_INT);
+    } else if (!ASTBool_value(ast, &val->b)) {
+        return find_builtin(BUILTIN_BOOL);
+    } else if (!ASTDouble_value(ast, &val->d)) {
+        return find_builtin(BUILTIN_DOUBLE);
+    } else if (!ASTString_value(ast, &val->s)) {
+        return find_builtin(BUILTIN_STRING);
+    }
+    return NULL;
+}
+
+/*
+ * Returns the builtin that values of type are instances of, or NULL.
+ */
+static const struct Builtin *
+type_builtin(const Type *type) {
+    if (TYPE_OBJECT != type->type) {
+        return NULL;
+    }
+    const struct ClassType *class = ((const struct ObjectType *)type)->class;
+    if (0 == class->id || NUM_BUILTINS < class->id) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
+        if (!strcmp(class->name, builtins[i].name)) {
+            return &builtins[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Create the literal of builtin with the value val, and the location and
+ * type of the expression ast that it replaces.
+ */
+static AST *
+new_literal(const AST *ast,
+    const struct Builtin *builtin,
+    union Literal val) {
+    AST *ret = NULL;
+    switch (builtin->type) {
+        case BUILTIN_INT:
+            ret = ASTInt(ast->loc, val.i);
+            break;
+        case BUILTIN_BOOL:
+            ret = ASTBool(ast->loc, val.b);
+            break;
+        case BUILTIN_DOUBLE:
+            if (!isfinite(val.d)) {
+                // There is no literal for it.
+                return NULL;
+            }
+            ret = ASTDouble(ast->loc, val.d);
+            break;
+        case BUILTIN_STRING:
+            ret = ASTString(ast->loc, dstring(val.s));
+            break;
+    }
+    ret->type = ast->type;
+    return ret;
+}
+
+/*
+ * Fold the comparison op given whether its operands compare less than, equal
+ * or greater than each other. Unordered doubles are none of the three, so
+ * only != holds for them, like in C.
+ */
+static AST *
+foldComparison(const AST *ast, const char *op, int lt, int eq, int gt) {
+    union Literal ret;
+    if (!strcmp(op, "==")) {
+        ret.b = eq;
+    } else if (!strcmp(op, "!=")) {
+        ret.b = !eq;
+    } else if (!strcmp(op, "<")) {
+        ret.b = lt;
+    } else if (!strcmp(op, ">")) {
+        ret.b = gt;
+    } else if (!strcmp(op, "<=")) {
+        ret.b = lt || eq;
+    } else {
+        ret.b = gt || eq;
+    }
+    return new_literal(ast, find_builtin(BUILTIN_BOOL), ret);
+}
+
+AST *
+foldBuiltinOperator(const AST *ast,
+    const char *op,
+    const AST *lhs,
+    const AST *rhs) {
+    union Literal a, b, ret;
+    const struct Builtin *builtin = literal_builtin(lhs, &a);
+    if (NULL == builtin || builtin != literal_builtin(rhs, &b)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(comparisons) / sizeof(*comparisons); i++) {
+        if (strcmp(op, comparisons[i].op)) {
+            continue;
+        }
+        if (0 == (builtin->comparisons & comparisons[i].type) ||
+            find_builtin(BUILTIN_BOOL) != type_builtin(ast->type)) {
+            return NULL;
+        }
+        switch (builtin->type) {
+            case BUILTIN_INT:
+                return foldComparison(ast, op, a.i < b.i, a.i == b.i,
+                    a.i > b.i);
+            case BUILTIN_BOOL:
+                return foldComparison(ast, op, a.b < b.b, a.b == b.b,
+                    a.b > b.b);
+            case BUILTIN_DOUBLE:
+                return foldComparison(ast, op, a.d < b.d, a.d == b.d,
+                    a.d > b.d);
+            case BUILTIN_STRING: {
+                int cmp = strcmp(a.s, b.s);
+                return foldComparison(ast, op, cmp < 0, cmp == 0, cmp > 0);
+            }
+        }
+    }
+    if (builtin != type_builtin(ast->type)) {
+        return NULL;
+    }
+    enum OPTYPE type = 0;
+    for (size_t i = 0; i < sizeof(operators) / sizeof(*operators); i++) {
+        if (!strcmp(op, operators[i].op)) {
+            type = operators[i].type;
+        }
+    }
+    if (0 == (builtin->operators & type)) {
+        return NULL;
+    }
+    switch (builtin->type) {
+        case BUILTIN_INT: {
+            // Overflow wraps around instead of being undefined.
+            uint64_t x = a.i, y = b.i;
+            switch (type) {
+                case PLUS:
+                    ret.i = (int64_t)(x + y);
+                    break;
+                case MINUS:
+                    ret.i = (int64_t)(x - y);
+                    break;
+                case TIMES:
+                    ret.i = (int64_t)(x * y);
+                    break;
+                case DIVIDE:
+                    if (0 == b.i || (INT64_MIN == a.i && -1 == b.i)) {
+                        // Left to trap at runtime.
+                        return NULL;
+                    }
+                    ret.i = a.i / b.i;
+                    break;
+            }
+            break;
+        }
+        case BUILTIN_BOOL:
+            // Bool has no operators.
+            return NULL;
+        case BUILTIN_DOUBLE:
+            switch (type) {
+                case PLUS:
+                    ret.d = a.d + b.d;
+                    break;
+                case MINUS:
+                    ret.d = a.d - b.d;
+                    break;
+                case TIMES:
+                    ret.d = a.d * b.d;
+                    break;
+                case DIVIDE:
+                    ret.d = a.d / b.d;
+                    break;
+            }
+            break;
+        case BUILTIN_STRING: {
+            dstring str = dstring(a.s);
+            append_str(&str, b.s);
+            ret.s = str.str;
+            AST *value = new_literal(ast, builtin, ret);
+            delete_dstring(str);
+            return value;
+        }
+    }
+    return new_literal(ast, builtin, ret);
+}
+
+AST *
+foldBuiltinCast(const AST *ast, const AST *expr) {
+    union Literal val, ret;
+    const struct Builtin *from = literal_builtin(expr, &val);
+    const struct Builtin *to = type_builtin(ast->type);
+    if (NULL == from || NULL == to || 0 == (from->casts & to->type)) {
+        return NULL;
+    }
+    // Only the values that the C casts are defined for are folded.
+    switch (to->type) {
+        case BUILTIN_INT:
+            if (BUILTIN_INT == from->type) {
+                ret.i = val.i;
+            } else if (BUILTIN_BOOL == from->type) {
+                ret.i = val.b;
+            } else if (-0x1p63 <= val.d && val.d < 0x1p63) {
+                ret.i = (int64_t)val.d;
+            } else {
+                return NULL;
+            }
+            break;
+        case BUILTIN_BOOL:
+            if (BUILTIN_INT == from->type) {
+                ret.b = (unsigned char)val.i;
+            } else if (BUILTIN_BOOL == from->type) {
+                ret.b = val.b;
+            } else if (-1.0 < val.d && val.d < 256.0) {
+                ret.b = (unsigned char)val.d;
+            } else {
+                return NULL;
+            }
+            if (1 < ret.b) {
+                // Bool literals are either 0 or 1.
+                return NULL;
+            }
+            break;
+        case BUILTIN_DOUBLE:
+            if (BUILTIN_INT == from->type) {
+                ret.d = (double)val.i;
+            } else if (BUILTIN_BOOL == from->type) {
+                ret.d = val.b;
+            } else {
+                ret.d = val.d;
+            }
+            break;
+        case BUILTIN_STRING: {
+            // Formatted the same way as the runtime's casts to string.
+            dstring str = dstring("");
+            if (BUILTIN_INT == from->type) {
+                vappend_str(&str, "%" PRId64, (int64_t)val.i);
+            } else if (BUILTIN_BOOL == from->type) {
+                vappend_str(&str, "%d", val.b);
+            } else if (BUILTIN_DOUBLE == from->type) {
+                vappend_str(&str, "%f", val.d);
+            } else {
+                append_str(&str, val.s);
+            }
+            ret.s = str.str;
+            AST *value = new_literal(ast, to, ret);
+            delete_dstring(str);
+            return value;
+        }
+    }
+    return new_literal(ast, to, ret);
+}
+
 static char *
 codeGen(void *this, FILE *out, UNUSED CodeGenState *state) {
     ASTProgram *ast = this;
@@ -280,446 +639,198 @@ codeGen(void *this, FILE *out, UNUSED CodeGenState *state) {
         0,
         0,
         0,
-        Map()
+        Map(),
+        ast->bindings,
+        ast->escapes,
+        Map(),
+        Map(),
+        Vector_size(ast->classes),
+        Vector(),
+        Map(),
+        NULL,
+        NULL
     };
     state = &newState;
 
-    fprintf(out, "#include <stdio.h>\n");
-    fprintf(out, "#include <stdlib.h>\n");
-    fprintf(out, "#include <string.h>\n");
-    fprintf(out, "#include <inttypes.h>\n");
-    fprintf(out, "\n");
-    fprintf(out, "#define ERROR(msg) { \\\n");
-    state->indent++;
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "perror(msg); \\\n");
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "exit(EXIT_FAILURE); \\\n");
-    state->indent--;
-    fprintf(out, "}\n");
-
-    fprintf(out, "#define CALL(closure, args) closure.fn(closure, args)\n");
-    fprintf(out, "\n");
-
-    fprintf(out, "struct closure;\n");
-    fprintf(out, "\n");
-
-    fprintf(out, "typedef struct closure closure;\n");
-    fprintf(out, "typedef void *FUNC(closure env, void **args);\n");
-    fprintf(out, "\n");
-
-    fprintf(out, "struct closure {\n");
-    state->indent++;
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "FUNC *fn;\n");
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "void **env;\n");
-    state->indent--;
-    fprintf(out, "};\n");
+    // The builtin classes are in the runtime library, see runtime/tlangrt.h.
+    fprintf(out, "#include \"tlangrt.h\"\n");
     fprintf(out, "\n");
 
     n = Vector_size(ast->functions);
-    if (n > 0) {
-        fprintf(out, "FUNC ");
-    }
-    char *sep = "";
     for (size_t i = 0; i < n; i++) {
         const struct FuncType *func = Vector_get(ast->functions, i);
         char *name = safe_asprintf("func%d", state->funcCount);
         state->funcCount++;
         Map_put(state->funcIDs, &func, sizeof(func), name, NULL);
-        fprintf(out, "%s%s", sep, name);
-        sep = ", ";
-    }
-    if (n > 0) {
-        fprintf(out, ";\n");
-        fprintf(out, "\n");
     }
 
-    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
-        struct Builtin builtin = builtins[i];
-        fprintf(out, "struct class_%s *\n", builtin.name);
-        fprintf(out, "builtin_%s(%s val);\n", builtin.name, builtin.ctype);
-        fprintf(out, "\n");
-    }
-    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
-        struct Builtin builtin = builtins[i];
-        fprintf(out, "typedef struct class_%s {\n", builtin.name);
-        state->indent++;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "%s val;\n", builtin.ctype);
-        size_t opCount = sizeof(operators) / sizeof(*operators);
-        for (size_t j = 0; j < opCount; j++) {
-            if (builtin.operators & operators[j].type) {
-                char op[strlen(operators[j].op) * 2 + 1];
-                strident(operators[j].op, op);
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out,
-                    "void *(*field_%s)(closure env, void **args);\n",
-                    op);
-
-                char assign_op[strlen(operators[j].assign_op) * 2 + 1];
-                strident(operators[j].assign_op, assign_op);
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out,
-                    "void *(*field_%s)(closure env, void **args);\n",
-                    assign_op);
-            }
-        }
-        for (size_t j = 0; j < sizeof(builtins) / sizeof(*builtins); j++) {
-            struct Builtin cast = builtins[j];
-            if (builtin.casts & cast.type) {
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out,
-                    "void *(*cast_class_%s)(closure env, void **args);\n",
-                    cast.name);
+    // Only the functions whose closures the emitted code creates are
+    // emitted, so the program's statements are generated first, then the
+    // functions they reach, and their declarations are written above.
+    FILE *globals = safe_tmpfile(),
+        *body = safe_tmpfile(),
+        *funcs = safe_tmpfile();
+
+    // Program symbols that are captured but only ever bound once always
+    // have the same value in a closure, so functions read them as globals.
+    n = Vector_size(ast->functions);
+    for (size_t i = 0; i < n; i++) {
+        const struct FuncType *func = Vector_get(ast->functions, i);
+        Iterator *it = Map_iterator(func->env);
+        while (it->hasNext(it)) {
+            MapIterData data = it->next(it);
+            Type *type;
+            AST *value;
+            if (Map_contains(state->globals, data.key, data.len) ||
+                Scope_get(ast->symbols, data.key, data.len, &type) ||
+                Map_get(state->bindings, data.key, data.len, &value) ||
+                NULL == value) {
+                continue;
             }
+            Map_put(state->globals, data.key, data.len, NULL, NULL);
+            char *typeName =
+                type->codeGen(type, intern_mangled(*(char **)data.key));
+            fprintf(globals, "static %s;\n", typeName);
+            free(typeName);
         }
-        state->indent--;
-        fprintf(out, "} *class_%s;\n", builtin.name);
-        fprintf(out, "\n");
-        if (builtin.type == BUILTIN_STRING) {
-            char assign_op[strlen("+=") * 2 + 1];
-            strident("+=", assign_op);
-            fprintf(out, "void *\n");
-            fprintf(out,
-                "class_%s_field_%s(closure env, void **args) {\n",
-                builtin.name,
-                assign_op);
-            state->indent++;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "class_%s this = env.env[0];\n", builtin.name);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "class_%s other = args[0];\n", builtin.name);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "size_t size = strlen(this->val);\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out,
-                "if (NULL == (this->val = realloc(this->val, size + strlen"
-                "(other->val) + 1))) {\n");
-            state->indent++;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "ERROR(\"realloc\");\n");
-            state->indent--;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "}\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "strcpy(this->val + size, other->val);\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "return this;\n");
-            state->indent--;
-            fprintf(out, "}\n");
-            fprintf(out, "\n");
-
-            char op[strlen("+") * 2 + 1];
-            strident("+", op);
-            fprintf(out, "void *\n");
-            fprintf(out,
-                "class_%s_field_%s(closure env, void **args) {\n",
-                builtin.name,
-                op);
-            state->indent++;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "class_%s this = env.env[0];\n", builtin.name);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "class_%s other = args[0];\n", builtin.name);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "size_t size1 = strlen(this->val),\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "       size2 = strlen(other->val);\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "char *val;\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "if (NULL == (val = malloc(size1 + size2 + 1))) {\n");
-            state->indent++;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "ERROR(\"malloc\");\n");
-            state->indent--;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "}\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "strcpy(val, this->val);\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "strcpy(val + size1, other->val);\n");
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "return builtin_string(val);\n");
-            state->indent--;
-            fprintf(out, "}\n");
-            fprintf(out, "\n");
-
-            fprintf(out, "void *\n");
-            fprintf(out,
-                "class_%s_cast_class_string(closure env, void **args) {\n",
-                builtin.name);
-            state->indent++;
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "class_%s this = env.env[0];\n", builtin.name);
-            fprintf(out, "%*s", state->indent * 4, "");
-            fprintf(out, "return builtin_string(this->val);\n");
-            state->indent--;
-            fprintf(out, "}\n");
-            fprintf(out, "\n");
-        } else {
-            for (size_t j = 0; j < opCount; j++) {
-                if (builtin.operators & operators[j].type) {
-                    char assign_op[strlen(operators[j].assign_op) * 2 + 1];
-                    strident(operators[j].assign_op, assign_op);
-                    fprintf(out, "void *\n");
-                    fprintf(out,
-                        "class_%s_field_%s(closure env, void **args) {\n",
-                        builtin.name,
-                        assign_op);
-                    state->indent++;
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out,
-                        "class_%s this = env.env[0];\n",
-                        builtin.name);
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out, "class_%s other = args[0];\n", builtin.name);
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out,
-                        "this->val %s other->val;\n",
-                        operators[j].assign_op);
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out, "return this;\n");
-                    state->indent--;
-                    fprintf(out, "}\n");
-                    fprintf(out, "\n");
-
-                    char op[strlen(operators[j].op) * 2 + 1];
-                    strident(operators[j].op, op);
-                    fprintf(out, "void *\n");
-                    fprintf(out,
-                        "class_%s_field_%s(closure env, void **args) {\n",
-                        builtin.name,
-                        op);
-                    state->indent++;
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out,
-                        "class_%s this = env.env[0];\n",
-                        builtin.name);
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out, "class_%s other = args[0];\n", builtin.name);
-                    fprintf(out, "%*s", state->indent * 4, "");
-                    fprintf(out,
-                        "return builtin_%s(this->val %s other->val);\n",
-                        builtin.name,
-                        operators[j].op);
-                    state->indent--;
-                    fprintf(out, "}\n");
-                    fprintf(out, "\n");
-                }
-            }
-            for (size_t j = 0; j < sizeof(builtins) / sizeof(*builtins); j++) {
-                struct Builtin cast = builtins[j];
-                if (builtin.casts & cast.type) {
-                    if (cast.type == BUILTIN_STRING) {
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "void *\n");
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "class_%s_cast_class_%s(closure env, void **args) "
-                            "{\n",
-                            builtin.name,
-                            cast.name);
-                        state->indent++;
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "class_%s this = env.env[0];\n",
-                            builtin.name);
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "size_t size = snprintf(NULL, 0, \"%s\", this->val);"
-                            "\n",
-                            builtin.fmt);
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "char *val;\n");
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "if (NULL == (val = malloc(size + 1))) {\n");
-                        state->indent++;
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "ERROR(\"malloc\");\n");
-                        state->indent--;
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "}\n");
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "sprintf(val, \"%s\", this->val);\n",
-                            builtin.fmt);
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "return builtin_string(val);\n");
-                        state->indent--;
-                        fprintf(out, "}\n");
-                        fprintf(out, "\n");
-                    } else {
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out, "void *\n");
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "class_%s_cast_class_%s(closure env, void "
-                            "**args) {\n",
-                            builtin.name,
-                            cast.name);
-                        state->indent++;
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "class_%s this = env.env[0];\n",
-                            builtin.name);
-                        fprintf(out, "%*s", state->indent * 4, "");
-                        fprintf(out,
-                            "return builtin_%s((%s)this->val);\n",
-                            cast.name,
-                            cast.ctype);
-                        state->indent--;
-                        fprintf(out, "}\n");
-                        fprintf(out, "\n");
-                    }
-                }
+        it->delete(it);
+    }
+
+    state->indent++;
+    n = Vector_size(ast->stmts);
+    for (size_t i = 0; i < n; i++) {
+        AST *stmt = Vector_get(ast->stmts, i);
+        state->prev = 0 == i
+            ? NULL
+            : Vector_get(ast->stmts, i - 1);
+        state->stmt = stmt;
+        char *code = stmt->codeGen(stmt, body, state);
+        free(code);
+    }
+    state->indent--;
+    Map *emitted = Map();
+    n = Vector_size(ast->functions);
+    for (size_t count = 0; count != Map_size(state->reached);) {
+        count = Map_size(state->reached);
+        for (size_t i = 0; i < n; i++) {
+            const struct FuncType *func = Vector_get(ast->functions, i);
+            if (!Map_contains(state->reached, &func, sizeof(func)) ||
+                Map_contains(emitted, &func, sizeof(func))) {
+                continue;
             }
+            Map_put(emitted, &func, sizeof(func), NULL, NULL);
+            char *name;
+            Map_get(state->funcIDs, &func, sizeof(func), &name);
+            codeGenFunc(func->ast, name, funcs, state);
         }
-        fprintf(out, "class_%s\n", builtin.name);
-        fprintf(out, "builtin_%s(%s val) {\n", builtin.name, builtin.ctype);
-        state->indent++;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "class_%s ret;\n", builtin.name);
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "if (NULL == (ret = malloc(sizeof(*ret)))) {\n");
-        state->indent++;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "ERROR(\"malloc\");\n");
-        state->indent--;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "}\n");
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "*ret = (struct class_%s) {\n", builtin.name);
-        state->indent++;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "val,\n");
-        for (size_t j = 0; j < opCount; j++) {
-            if (builtin.operators & operators[j].type) {
-                char op[strlen(operators[j].op) * 2 + 1];
-                strident(operators[j].op, op);
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out, "class_%s_field_%s,\n", builtin.name, op);
-
-                char assign_op[strlen(operators[j].assign_op) * 2 + 1];
-                strident(operators[j].assign_op, assign_op);
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out, "class_%s_field_%s,\n", builtin.name, assign_op);
-            }
+    }
+    delete_Map(emitted, NULL);
+
+    // Typedefs for the function signatures and tuples of the symbols and
+    // temps that the emitted code declares, and of the emitted functions.
+    Map *signatures = Map();
+    Iterator *it = Scope_iterator(ast->symbols);
+    while (it->hasNext(it)) {
+        typedef_Type(it->next(it).value, signatures, out);
+    }
+    it->delete(it);
+    n = Vector_size(ast->scopes);
+    for (size_t i = 0; i < n; i++) {
+        it = Scope_iterator(Vector_get(ast->scopes, i));
+        while (it->hasNext(it)) {
+            typedef_Type(it->next(it).value, signatures, out);
         }
-        for (size_t j = 0; j < sizeof(builtins) / sizeof(*builtins); j++) {
-            struct Builtin cast = builtins[j];
-            if (builtin.casts & cast.type) {
-                fprintf(out, "%*s", state->indent * 4, "");
-                fprintf(out,
-                    "class_%s_cast_class_%s,\n",
-                    builtin.name,
-                    cast.name);
-            }
+        it->delete(it);
+    }
+    n = Vector_size(ast->functions);
+    for (size_t i = 0; i < n; i++) {
+        const struct FuncType *func = Vector_get(ast->functions, i);
+        if (!Map_contains(state->reached, &func, sizeof(func))) {
+            continue;
         }
-        state->indent--;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "};\n");
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "return ret;\n");
-        state->indent--;
-        fprintf(out, "}\n");
-        fprintf(out, "\n");
+        typedef_FuncType(func, signatures, out);
+        codeGenFuncTypedefs(func->ast, signatures, out);
+    }
+    size_t ntemps = Vector_size(state->temps);
+    for (size_t i = 0; i < ntemps; i++) {
+        typedef_Type(Vector_get(state->temps, i), signatures, out);
+    }
+    delete_Map(signatures, NULL);
 
-        fprintf(out, "void *\n");
-        fprintf(out, "new_%s(closure env, void **args) {\n", builtin.name);
-        state->indent++;
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "return builtin_%s(0);\n", builtin.name);
-        state->indent--;
-        fprintf(out, "}\n");
+    copy_file(globals, out);
+    if (0 < Map_size(state->globals)) {
         fprintf(out, "\n");
     }
 
-    n = Vector_size(ast->functions);
     for (size_t i = 0; i < n; i++) {
         const struct FuncType *func = Vector_get(ast->functions, i);
+        if (!Map_contains(state->reached, &func, sizeof(func))) {
+            continue;
+        }
         char *name;
         Map_get(state->funcIDs, &func, sizeof(func), &name);
-        fprintf(out, "void *\n%s(closure env, void **args) {\n", name);
-        state->indent++;
-        codeGenFuncBody(func->ast, out, &newState);
-        state->indent--;
-        fprintf(out, "}\n");
+        codeGenFuncDecl(func->ast, name, out, state);
+    }
+    if (0 < Map_size(state->reached)) {
         fprintf(out, "\n");
     }
+    copy_file(funcs, out);
 
-    fprintf(out, "int\nmain(int argc, char *argv[]) {\n");
+    fprintf(out, "int\nmain(void) {\n");
     state->indent++;
-    Iterator *it = Map_iterator(ast->symbols);
+    it = Scope_iterator(ast->symbols);
     while (it->hasNext(it)) {
         MapIterData data = it->next(it);
+        if (Map_contains(state->globals, data.key, data.len)) {
+            continue;
+        }
         Type *type = data.value;
-        char
-            *name = safe_asprintf("var_%.*s", (int)data.len, (char *)data.key);
+        // Classes have no value at run time, init calls their constructor.
+        if (TYPE_CLASS == type->type) {
+            continue;
+        }
+        const char *name = intern_mangled(*(char **)data.key);
         char *typeName = type->codeGen(type, name);
-        free(name);
         fprintf(out, "%*s", state->indent * 4, "");
         fprintf(out, "%s;\n", typeName);
         free(typeName);
     }
     it->delete(it);
     fprintf(out, "\n");
-    for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); i++) {
-        struct Builtin builtin = builtins[i];
-        fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out,
-            "var_%s = (closure){ new_%s, NULL };\n",
-            builtin.name,
-            builtin.name);
-    }
-    n = Vector_size(ast->stmts);
-    for (size_t i = 0; i < n; i++) {
-        AST *stmt = Vector_get(ast->stmts, i);
-        char *code = stmt->codeGen(stmt, out, &newState);
-        free(code);
-    }
+    copy_file(body, out);
     state->indent--;
     fprintf(out, "}\n");
     delete_Map(state->funcIDs, free);
+    delete_Map(state->globals, NULL);
+    delete_Map(state->reached, NULL);
+    delete_Vector(state->temps, NULL);
+    delete_Map(state->bounds, NULL);
     return NULL;
 }
 
-static void
-delete_compare(Map *compare) {
-    delete_Map(compare, NULL);
-}
-
-static void
-delete(void *this) {
-    ASTProgram *ast = this;
-    delete_Vector(ast->stmts, (VEC_DELETE_FUNC)delete_AST);
-    delete_Map(ast->symbols, (MAP_DELETE_FUNC)delete_type);
-    delete_Map(ast->compare, (MAP_DELETE_FUNC)delete_compare);
-    delete_Vector(ast->classes, (VEC_DELETE_FUNC)delete_ClassType);
-    delete_Vector(ast->functions, NULL);
-    free(this);
-}
-
 AST *
 new_ASTProgram(YYLTYPE loc, Vector *stmts) {
     ASTProgram *program = NULL;
-    Map *symbols, *compare;
-    Vector *classes, *functions;
+    Scope *symbols;
+    Vector *classes, *functions, *scopes;
+    SubtypeMatrix *subtypes;
+    Map *bindings;
+    Escapes *escapes;
 
-    program = safe_malloc(sizeof(*program));
-    symbols = Map();
+    program = arena_malloc(sizeof(*program));
+    symbols = Scope(NULL);
     classes = Vector();
     functions = Vector();
-    compare = Map();
+    scopes = Vector();
+    subtypes = SubtypeMatrix();
+    bindings = Map();
+    escapes = Escapes();
     *program = (ASTProgram){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
@@ -727,7 +838,10 @@ new_ASTProgram(YYLTYPE loc, Vector *stmts) {
         symbols,
         classes,
         functions,
-        compare
+        scopes,
+        subtypes,
+        bindings,
+        escapes
     };
     return (AST *)program;
 }
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 
@@ -69,12 +70,21 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
     return 0;
 }
 
+static AST *
+fold(void *this, FoldState *state) {
+    ASTReturn *ast = this;
+    if (NULL != ast->expr) {
+        ast->expr = ast->expr->fold(ast->expr, state);
+    }
+    return this;
+}
+
 static char *
 codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTReturn *ast = this;
     if (NULL == ast->expr) {
         fprintf(out, "%*s", state->indent * 4, "");
-        fprintf(out, "return NULL;\n");
+        fprintf(out, "return;\n");
     } else {
         char *code = ast->expr->codeGen(ast->expr, out, state);
 
@@ -85,26 +95,17 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     return NULL;
 }
 
-static void
-delete(void *this) {
-    ASTReturn *ast = this;
-    if (NULL != ast->expr) {
-        delete_AST(ast->expr);
-    }
-    free(this);
-}
-
 AST *
 new_ASTReturn(YYLTYPE loc, AST *expr) {
     ASTReturn *ret = NULL;
 
-    ret = safe_malloc(sizeof(*ret));
+    ret = arena_malloc(sizeof(*ret));
     *ret = (ASTReturn){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
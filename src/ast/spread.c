@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
@@ -45,28 +46,73 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     return 0;
 }
 
+static AST *
+fold(void *this, FoldState *state) {
+    ASTSpread *ast = this;
+    ast->expr = ast->expr->fold(ast->expr, state);
+    return this;
+}
+
 static char *
 codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     return safe_strdup("/* SPREAD NOT IMPLEMENTED */");
 }
 
-static void
-delete(void *this) {
-    ASTSpread *ast = this;
-    delete_AST(ast->expr);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+Vector *
+codeGenSpread(AST *ast, FILE *out, CodeGenState *state) {
+    ASTSpread *spread = (ASTSpread *)ast;
+    const struct TupleType *tuple =
+        (const struct TupleType *)spread->expr->type;
+    Vector *values = Vector();
+    const SparseVector *exprs = ASTTuple_exprs(spread->expr);
+    if (NULL != exprs) {
+        size_t n = SparseVector_size(exprs);
+        for (size_t i = 0; i < n; i++) {
+            AST *expr;
+            ull count;
+            SparseVector_get(exprs, i, &expr, &count);
+            char *code = expr->codeGen(expr, out, state);
+            char *tmp = safe_asprintf("temp%d", state->tempCount);
+            state->tempCount++;
+            char *typeName = expr->type->codeGen(expr->type, tmp);
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "%s = %s;\n", typeName, code);
+            free(typeName);
+            free(code);
+            for (ull j = 0; j < count; j++) {
+                Vector_append(values, safe_strdup(tmp));
+            }
+            free(tmp);
+        }
+        return values;
+    }
+    char *code = spread->expr->codeGen(spread->expr, out, state);
+    if (NULL == ASTVariable_name(spread->expr)) {
+        char *tmp = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        Vector_append(state->temps, spread->expr->type);
+        char *typeName = tuple->super.codeGen(tuple, tmp);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "%s = %s;\n", typeName, code);
+        free(typeName);
+        free(code);
+        code = tmp;
+    }
+    ull count = SparseVector_count(tuple->types);
+    for (ull i = 0; i < count; i++) {
+        Vector_append(values, TupleType_field(tuple, code, i));
     }
-    free(this);
+    free(code);
+    return values;
 }
 
 AST *
 new_ASTSpread(YYLTYPE loc, AST *expr) {
     ASTSpread *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTSpread){
-        { json, getType, codeGen, delete, loc, NULL }, expr
+        { json, getType, fold, codeGen, loc, NULL }, expr
     };
     return (AST *)node;
 }
@@ -1,9 +1,12 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "dynamic_string.h"
 #include "parser.h"
+#include "escape.h"
+#include "util.h"
 
 typedef struct ASTString ASTString;
 
@@ -25,18 +28,22 @@ json(const void *this, FILE *out, int indent) {
 }
 
 static int
-getType(void *this, UNUSED TypeCheckState *state, Type **typeptr) {
+getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTString *ast = this;
-    char *msg;
-    if (ast->super.type->verify(ast->super.type, state, &msg)) {
-        print_code_error(stderr, ast->super.loc, "%s", msg);
-        free(msg);
-        return 1;
-    }
-    *typeptr = ast->super.type;
+    *typeptr = ast->super.type = BuiltinType(BUILTIN_STRING, state);
+    Escapes_alloc(state->escapes,
+        this,
+        NULL,
+        NULL != state->funcType,
+        state->symbols != state->frame);
     return 0;
 }
 
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
+}
+
 static char *
 codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTString *ast = this;
@@ -45,7 +52,9 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     fprintf(out, "%*s", state->indent * 4, "");
     fprintf(out, "char *%s;\n", tmp);
     fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "if (NULL == (%s = strdup(\"%s\"))) {\n", tmp, ast->str.str);
+    fprintf(out, "if (NULL == (%s = strdup(", tmp);
+    fprint_c_string(out, ast->str.str);
+    fprintf(out, "))) {\n");
     state->indent++;
     fprintf(out, "%*s", state->indent * 4, "");
     fprintf(out, "ERROR(\"strdup\");\n");
@@ -54,38 +63,52 @@ codeGen(void *this, FILE *out, CodeGenState *state) {
     fprintf(out, "}\n");
     char *ret = safe_asprintf("temp%d", state->tempCount);
     state->tempCount++;
-    fprintf(out, "%*s", state->indent * 4, "");
-    fprintf(out, "class_string %s = builtin_string(%s);\n", ret, tmp);
+    if (Escapes_escapes(state->escapes, this)) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "class_string %s = builtin_string(%s);\n", ret, tmp);
+    } else {
+        char *box = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "struct class_string %s = { &vtable_string, %s };\n",
+            box,
+            tmp);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "class_string %s = &%s;\n", ret, box);
+        free(box);
+    }
     free(tmp);
     return ret;
 }
 
-static void
-delete(void *this) {
-    ASTString *ast = this;
-    delete_dstring(ast->str);
-    delete_type(ast->super.type);
-    free(this);
+int
+ASTString_value(const AST *ast, const char **val) {
+    if (codeGen != ast->codeGen) {
+        return 1;
+    }
+    *val = ((const ASTString *)ast)->str.str;
+    return 0;
 }
 
 AST *
 new_ASTString(YYLTYPE loc, dstring str) {
     ASTString *node = NULL;
-    Type *type;
-
-    type = ObjectType(loc, safe_strdup("string"), Vector());
-    type->init = 1;
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTString){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
-            type
+            NULL
         },
-        str
+        {
+            Arena_strndup(Arena_current(), str.str, str.size - 1),
+            str.size
+        }
     };
+    delete_dstring(str);
     return (AST *)node;
 }
@@ -1,11 +1,18 @@
 #include "ast.h"
 #include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <ast.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
+#include "util.h"
 
 typedef struct ASTSwitch ASTSwitch;
 
@@ -17,8 +24,8 @@ struct ASTSwitch {
     Vector *cases;       // Vector<Case*>
     Vector *def;         // NULLable Vector<AST*>
     // NULL until type checker is executed:
-    Vector *symbolsList; // Vector<Map<char*, Type*>>
-    Map *defSymbols;     // Map<char*, Type*>
+    Vector *symbolsList; // Vector<Scope<char*, Type*>>
+    Scope *defSymbols;   // Scope<char*, Type*>
 };
 
 static void
@@ -78,9 +85,9 @@ exprCase(struct Case *c,
     }
     const struct ObjectType *object = (const struct ObjectType *)switchType;
     const struct ClassType *class = object->class;
-    const char *fieldName = "==";
+    const char *fieldName = intern("==");
     Type *fieldType;
-    if (Map_get(class->fieldTypes, fieldName, strlen(fieldName), &fieldType)) {
+    if (Map_get(class->fieldTypes, &fieldName, sizeof(fieldName), &fieldType)) {
         char *switchName = switchType->toString(switchType);
         print_code_error(stderr,
             c->expr->loc,
@@ -113,7 +120,7 @@ exprCase(struct Case *c,
     Type *retType = found->ret_type;
     const struct ObjectType *ret = (const struct ObjectType *)retType;
     if (TYPE_OBJECT != retType->type || ret->class->super.compare(ret->class,
-        state->builtins[BUILTIN_BOOL],
+        BuiltinClass(BUILTIN_BOOL, state),
         state)) {
         print_code_error(stderr,
             c->expr->loc,
@@ -146,14 +153,29 @@ typeCase(struct Case *c, Type *exprType, TypeCheckState *state) {
         free(caseTypeName);
         return 1;
     }
-    Type *prevType = NULL, *type_copy = copy_type(c->type.type);
-    Map_put(state->symbols,
+    if (TYPE_OBJECT == c->type.type->type) {
+        Vector_append(state->typeCases,
+            ((const struct ObjectType *)c->type.type)->class);
+    }
+    // The case's variable is defined like any other symbol, so inside a
+    // function it is a local rather than a capture.
+    if (NULL != state->usedSymbols) {
+        Map_put(state->usedSymbols,
+            &c->type.name,
+            sizeof(c->type.name),
+            NULL,
+            NULL);
+    }
+    BindSymbol(state, c->type.name, NULL);
+    if (AddSymbol(state->symbols,
         c->type.name,
-        strlen(c->type.name),
-        type_copy,
-        &prevType);
-    if (NULL != prevType) {
-        delete_type(prevType);
+        copy_type(c->type.type),
+        0,
+        state,
+        &msg)) {
+        print_code_error(stderr, c->type.type->loc, "%s", msg);
+        free(msg);
+        return 1;
     }
     return typeCheckStmts(c->stmts, state);
 }
@@ -176,14 +198,15 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     size_t ncases = Vector_size(ast->cases);
     ast->symbolsList = new_Vector(ncases);
     Vector *initList = new_Vector(ncases);
-    Map *prevSymbols = state->symbols;
+    Scope *prevSymbols = state->symbols;
     Map *prevNewInit = state->newInitSymbols;
     Type *prevRetType = state->retType;
     for (size_t i = 0; i < ncases; i++) {
-        state->symbols = copy_Map(prevSymbols, (MAP_COPY_FUNC)copy_type);
+        state->symbols = Scope(prevSymbols);
         state->newInitSymbols = Map();
         state->retType = NULL;
         Vector_append(ast->symbolsList, state->symbols);
+        Vector_append(state->scopes, state->symbols);
         Vector_append(initList, state->newInitSymbols);
         struct Case *c = Vector_get(ast->cases, i);
         switch (c->caseType) {
@@ -201,8 +224,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
         }
     }
     if (ast->def != NULL) {
-        state->symbols = ast->defSymbols =
-            copy_Map(prevSymbols, (MAP_COPY_FUNC)copy_type);
+        state->symbols = ast->defSymbols = Scope(prevSymbols);
+        Vector_append(state->scopes, ast->defSymbols);
         state->newInitSymbols = Map();
         state->retType = NULL;
         status = typeCheckStmts(ast->def, state) || status;
@@ -210,9 +233,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
         Iterator *it = Map_iterator(state->newInitSymbols);
         while (it->hasNext(it)) {
             MapIterData symbol = it->next(it);
-            Type *type;
             // Check the outer symbol table to make sure it exists first
-            if (!Map_get(prevSymbols, symbol.key, symbol.len, &type)) {
+            if (Scope_contains(prevSymbols, symbol.key, symbol.len)) {
                 int found = 1;
                 // Search each case to see if the variable is not initialized in
                 // any of them
@@ -227,7 +249,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
                 // initialized in the outer symbol table, then add it to the
                 // outer init list.
                 if (found) {
-                    type->init = 1;
+                    InitSymbol(prevSymbols, symbol.key, symbol.len);
                     if (NULL != prevNewInit) {
                         Map_put(prevNewInit,
                             symbol.key,
@@ -253,31 +275,600 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     return status;
 }
 
+static AST *
+fold(void *this, FoldState *state) {
+    ASTSwitch *ast = this;
+    ast->expr = ast->expr->fold(ast->expr, state);
+    size_t n = Vector_size(ast->cases);
+    for (size_t i = 0; i < n; i++) {
+        struct Case *c = Vector_get(ast->cases, i);
+        if (CASE_EXPR == c->caseType) {
+            c->expr = c->expr->fold(c->expr, state);
+        }
+        fold_vector(c->stmts, state);
+    }
+    if (NULL != ast->def) {
+        fold_vector(ast->def, state);
+    }
+    return this;
+}
+
+// How a switch with only expression cases is lowered to C.
+enum LOWERING {
+    LOWER_CHAIN,  // if-else chain of == calls, in the order of the cases
+    LOWER_SWITCH, // C switch over int or bool literals
+    LOWER_HASH,   // C switch over a perfect hash of string literals
+    LOWER_TYPES   // C switch over a table from class IDs to type cases
+};
+
+static enum LOWERING
+lowering(const ASTSwitch *ast) {
+    const struct ClassType *class =
+        ((const struct ObjectType *)ast->expr->type)->class;
+    size_t n = Vector_size(ast->cases);
+    size_t ntypes = 0;
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        ntypes += CASE_TYPE == c->caseType;
+    }
+    if (0 < ntypes) {
+        // Unboxed values have no class ID, so their type cases are
+        // resolved statically.
+        return ntypes == n && 1 < n && NULL == class->ctype
+            ? LOWER_TYPES
+            : LOWER_CHAIN;
+    }
+    if (0 == class->id || NUM_BUILTINS < class->id) {
+        return LOWER_CHAIN;
+    }
+    int isString = !strcmp(class->name, "string");
+    int isIntegral = !strcmp(class->name, "int") ||
+        !strcmp(class->name, "bool");
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        long long int i_val;
+        int b_val;
+        const char *s_val;
+        if (isIntegral && (!ASTInt_value(c->expr, &i_val) ||
+            !ASTBool_value(c->expr, &b_val))) {
+            continue;
+        }
+        if (isString && !ASTString_value(c->expr, &s_val)) {
+            continue;
+        }
+        return LOWER_CHAIN;
+    }
+    return isString
+        ? LOWER_HASH
+        : isIntegral
+            ? LOWER_SWITCH
+            : LOWER_CHAIN;
+}
+
+/*
+ * Emit the block of a case followed by the break out of the C switch.
+ */
+static void
+codeGenCase(Scope *symbols, Vector *stmts, FILE *out, CodeGenState *state) {
+    state->indent++;
+    codeGenBlock(symbols, stmts, out, state);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "break;\n");
+    state->indent--;
+}
+
+static void
+codeGenSwitch(const ASTSwitch *ast,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "switch (%s) {\n", value);
+    state->indent++;
+    // A later case with the same value as an earlier one is unreachable.
+    Map *seen = Map(); // Map<long long int, NULL>
+    size_t n = Vector_size(ast->cases);
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        long long int val;
+        int b;
+        if (ASTInt_value(c->expr, &val)) {
+            ASTBool_value(c->expr, &b);
+            val = b;
+        }
+        if (Map_contains(seen, &val, sizeof(val))) {
+            continue;
+        }
+        Map_put(seen, &val, sizeof(val), NULL, NULL);
+        char *label = c->expr->codeGen(c->expr, out, state);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "case %s: {\n", label);
+        free(label);
+        codeGenCase(Vector_get(ast->symbolsList, i), c->stmts, out, state);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    delete_Map(seen, NULL);
+    if (NULL != ast->def) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "default: {\n");
+        codeGenCase(ast->defSymbols, ast->def, out, state);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    state->indent--;
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "}\n");
+}
+
+/*
+ * The same hash as hash_string() in the runtime library, which the generated
+ * code dispatches on.
+ */
+static uint64_t
+hash_string(const char *val, uint64_t seed) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (; '\0' != *val; val++) {
+        h ^= (unsigned char)*val;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+#define HASH_SEEDS 1024
+#define HASH_EXTRA_BITS 3
+
+/*
+ * Find the seed and the number of top bits of hash_string() that spread the n
+ * strs over the fewest slots with no two in the same one. If there is no
+ * such seed, the one whose fullest slot has the fewest strs is used, so some
+ * slots have to compare against more than one string. Returns the number of
+ * strs in the fullest slot.
+ */
+static size_t
+perfect_hash(const char **strs, size_t n, uint64_t *seed, unsigned *bits) {
+    unsigned minBits = 1;
+    while (((size_t)1 << minBits) < n) {
+        minBits++;
+    }
+    size_t best = n + 1;
+    unsigned maxBits = minBits + HASH_EXTRA_BITS;
+    size_t *counts = safe_malloc(sizeof(*counts) << maxBits);
+    for (unsigned b = minBits; b <= maxBits; b++) {
+        for (uint64_t s = 0; s < HASH_SEEDS; s++) {
+            memset(counts, 0, sizeof(*counts) << b);
+            size_t fullest = 0;
+            for (size_t i = 0; i < n && fullest < best; i++) {
+                size_t slot = hash_string(strs[i], s) >> (64 - b);
+                if (fullest < ++counts[slot]) {
+                    fullest = counts[slot];
+                }
+            }
+            if (fullest < best) {
+                best = fullest;
+                *seed = s;
+                *bits = b;
+            }
+            if (best <= 1) {
+                free(counts);
+                return best;
+            }
+        }
+    }
+    free(counts);
+    return best;
+}
+
+static void
+codeGenHash(const ASTSwitch *ast,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    // The index of each distinct case string in the cases, since a later
+    // case with the same string as an earlier one is unreachable.
+    size_t n = Vector_size(ast->cases);
+    const char *strs[n];
+    size_t cases[n];
+    size_t nstrs = 0;
+    Map *seen = Map(); // Map<char[], NULL>
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        const char *str;
+        ASTString_value(c->expr, &str);
+        if (Map_contains(seen, str, strlen(str))) {
+            continue;
+        }
+        Map_put(seen, str, strlen(str), NULL, NULL);
+        strs[nstrs] = str;
+        cases[nstrs] = i;
+        nstrs++;
+    }
+    delete_Map(seen, NULL);
+    char *unmatched = NULL;
+    if (NULL != ast->def) {
+        unmatched = safe_asprintf("temp%d", state->tempCount);
+        state->tempCount++;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "unsigned char %s = 1;\n", unmatched);
+    }
+    if (0 < nstrs) {
+        uint64_t seed = 0;
+        unsigned bits = 1;
+        perfect_hash(strs, nstrs, &seed, &bits);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "switch (hash_string(%s->val, %" PRIu64 "u) >> %u) {\n",
+            value,
+            seed,
+            64 - bits);
+        state->indent++;
+        for (size_t slot = 0; slot < ((size_t)1 << bits); slot++) {
+            int first = 1;
+            for (size_t i = 0; i < nstrs; i++) {
+                if (slot != hash_string(strs[i], seed) >> (64 - bits)) {
+                    continue;
+                }
+                fprintf(out, "%*s", state->indent * 4, "");
+                if (first) {
+                    fprintf(out, "case %zu:\n", slot);
+                    state->indent++;
+                    fprintf(out, "%*s", state->indent * 4, "");
+                    fprintf(out, "if (!strcmp(%s->val, ", value);
+                    first = 0;
+                } else {
+                    fprintf(out, "} else if (!strcmp(%s->val, ", value);
+                }
+                fprint_c_string(out, strs[i]);
+                fprintf(out, ")) {\n");
+                state->indent++;
+                if (NULL != unmatched) {
+                    fprintf(out, "%*s", state->indent * 4, "");
+                    fprintf(out, "%s = 0;\n", unmatched);
+                }
+                const struct Case *c = Vector_get(ast->cases, cases[i]);
+                codeGenBlock(Vector_get(ast->symbolsList, cases[i]),
+                    c->stmts,
+                    out,
+                    state);
+                state->indent--;
+            }
+            if (!first) {
+                fprintf(out, "%*s", state->indent * 4, "");
+                fprintf(out, "}\n");
+                fprintf(out, "%*s", state->indent * 4, "");
+                fprintf(out, "break;\n");
+                state->indent--;
+            }
+        }
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    if (NULL != unmatched) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "if (%s) {\n", unmatched);
+        state->indent++;
+        codeGenBlock(ast->defSymbols, ast->def, out, state);
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+        free(unmatched);
+    }
+}
+
+/*
+ * Returns the C expression for whether value, an instance of class, is equal
+ * to code according to class's == operator.
+ */
 static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* SWITCH NOT IMPLEMENTED */");
+codeGenEquals(const struct ClassType *class,
+    const char *value,
+    const char *code) {
+    if (NULL != class->ctype) {
+        return safe_asprintf("%s == %s", value, code);
+    }
+    if (0 < class->id && class->id <= NUM_BUILTINS) {
+        // Builtins have no subclasses, so call the operator directly.
+        return safe_asprintf("class_%s_field_3D3D_direct(%s, %s)",
+            class->name,
+            value,
+            code);
+    }
+    return safe_asprintf("%s->vtable->field_3D3D(%s, %s)",
+        value,
+        value,
+        code);
+}
+
+/*
+ * Returns 1 if the class with the ID id is a subtype of class, which a type
+ * case tests for, otherwise 0.
+ */
+static int
+has_subtype(const struct ClassType *class, size_t id) {
+    return class->subtypes[id / 64] >> id % 64 & 1;
+}
+
+/*
+ * Returns the C expression for whether the class ID of value, which is boxed,
+ * is a subtype of class. That's one bit test of the bitset of class's
+ * subtypes, which is a constant if the program has few enough classes.
+ */
+static char *
+codeGenIsA(const struct ClassType *class,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    size_t nwords = state->nclasses / 64 + 1;
+    if (1 == nwords) {
+        return safe_asprintf("(UINT64_C(0x%016" PRIx64 ") >> %s->vtable->id "
+            "& 1)",
+            class->subtypes[0],
+            value);
+    }
+    char *table = safe_asprintf("temp%d", state->tempCount);
+    state->tempCount++;
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "static const uint64_t %s[] = {", table);
+    for (size_t i = 0; i < nwords; i++) {
+        fprintf(out,
+            "%sUINT64_C(0x%016" PRIx64 ")",
+            0 < i
+                ? ", "
+                : " ",
+            class->subtypes[i]);
+    }
+    fprintf(out, " };\n");
+    char *ret = safe_asprintf("(%s[%s->vtable->id / 64] >> "
+        "%s->vtable->id %% 64 & 1)",
+        table,
+        value,
+        value);
+    free(table);
+    return ret;
+}
+
+/*
+ * Emit the block of the type case i, whose variable is bound to value.
+ */
+static void
+codeGenTypeCase(const ASTSwitch *ast,
+    size_t i,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    const struct Case *c = Vector_get(ast->cases, i);
+    Vector *cells = codeGenLocals(Vector_get(ast->symbolsList, i),
+        out,
+        state);
+    char *typeName = c->type.type->codeGen(c->type.type, NULL);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out,
+        "%s = (%s)%s;\n",
+        intern_mangled(c->type.name),
+        typeName,
+        value);
+    free(typeName);
+    codeGenStmts(c->stmts, cells, out, state);
+}
+
+/*
+ * Returns the class that the type case i tests for.
+ */
+static const struct ClassType *
+case_class(const ASTSwitch *ast, size_t i) {
+    const struct Case *c = Vector_get(ast->cases, i);
+    return ((const struct ObjectType *)c->type.type)->class;
+}
+
+/*
+ * Returns the index of the first type case that every value of the switch
+ * matches because its static class is a subtype of the case's, or the number
+ * of cases if there is none. The cases after it are unreachable.
+ */
+static size_t
+static_match(const ASTSwitch *ast) {
+    const struct ClassType *class =
+        ((const struct ObjectType *)ast->expr->type)->class;
+    size_t n = Vector_size(ast->cases);
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        if (CASE_TYPE == c->caseType &&
+            has_subtype(case_class(ast, i), class->id)) {
+            return i;
+        }
+    }
+    return n;
 }
 
 static void
-delete_symbols(Map *symbols) {
-    delete_Map(symbols, (MAP_DELETE_FUNC)delete_type);
+codeGenTypes(const ASTSwitch *ast,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    // Each class ID maps to the first case that it matches, so the table
+    // lookup replaces testing the cases one by one.
+    size_t ndynamic = static_match(ast);
+    char *table = safe_asprintf("temp%d", state->tempCount);
+    state->tempCount++;
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out,
+        "static const %s %s[] = {",
+        ndynamic <= UCHAR_MAX
+            ? "unsigned char"
+            : "unsigned int",
+        table);
+    for (size_t id = 0; id <= state->nclasses; id++) {
+        size_t i = 0;
+        while (i < ndynamic &&
+            (0 == id || !has_subtype(case_class(ast, i), id))) {
+            i++;
+        }
+        fprintf(out, "%s%zu", 0 < id ? ", " : " ", i);
+    }
+    fprintf(out, " };\n");
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "switch (%s[%s->vtable->id]) {\n", table, value);
+    free(table);
+    state->indent++;
+    for (size_t i = 0; i < ndynamic; i++) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "case %zu: {\n", i);
+        state->indent++;
+        codeGenTypeCase(ast, i, value, out, state);
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "break;\n");
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    if (ndynamic < Vector_size(ast->cases) || NULL != ast->def) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "default: {\n");
+        state->indent++;
+        if (ndynamic < Vector_size(ast->cases)) {
+            codeGenTypeCase(ast, ndynamic, value, out, state);
+        } else {
+            codeGenBlock(ast->defSymbols, ast->def, out, state);
+        }
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "break;\n");
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    state->indent--;
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "}\n");
 }
 
 static void
-delete(void *this) {
+codeGenChain(const ASTSwitch *ast,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    const struct ClassType *class =
+        ((const struct ObjectType *)ast->expr->type)->class;
+    size_t n = static_match(ast);
+    size_t depth = 0;
+    int open = 0; // The block of the last case's if is still open.
+    for (size_t i = 0; i < n; i++) {
+        const struct Case *c = Vector_get(ast->cases, i);
+        const struct ClassType *caseClass = CASE_TYPE == c->caseType
+            ? case_class(ast, i)
+            : NULL;
+        if (NULL != caseClass && NULL != class->ctype) {
+            // Unboxed values are never of a class other than their static
+            // one, so the case can't match.
+            continue;
+        }
+        if (open) {
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "} else {\n");
+            state->indent++;
+            depth++;
+        }
+        char *cond;
+        if (NULL == caseClass) {
+            // Each case's expression is only evaluated if the ones before it
+            // didn't match.
+            char *code = c->expr->codeGen(c->expr, out, state);
+            cond = codeGenEquals(class, value, code);
+            free(code);
+        } else {
+            cond = codeGenIsA(caseClass, value, out, state);
+        }
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "if (%s) {\n", cond);
+        free(cond);
+        state->indent++;
+        if (NULL == caseClass) {
+            codeGenBlock(Vector_get(ast->symbolsList, i),
+                c->stmts,
+                out,
+                state);
+        } else {
+            codeGenTypeCase(ast, i, value, out, state);
+        }
+        state->indent--;
+        open = 1;
+    }
+    // A case that matches statically takes the place of the default.
+    int matched = n < Vector_size(ast->cases);
+    if (matched || NULL != ast->def) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out,
+            "%s\n",
+            open
+                ? "} else {"
+                : "{");
+        state->indent++;
+        if (matched) {
+            codeGenTypeCase(ast, n, value, out, state);
+        } else {
+            codeGenBlock(ast->defSymbols, ast->def, out, state);
+        }
+        state->indent--;
+        open = 1;
+    }
+    if (open) {
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    while (0 < depth--) {
+        state->indent--;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+}
+
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTSwitch *ast = this;
-    delete_AST(ast->expr);
-    delete_Vector(ast->cases, (VEC_DELETE_FUNC)delete_case);
-    if (NULL != ast->def) {
-        delete_Vector(ast->def, (VEC_DELETE_FUNC)delete_AST);
+    size_t n = Vector_size(ast->cases);
+    if (0 < n && TYPE_OBJECT != ast->expr->type->type) {
+        return safe_strdup("/* SWITCH NOT IMPLEMENTED */");
     }
-    if (NULL != ast->symbolsList) {
-        delete_Vector(ast->symbolsList, (VEC_DELETE_FUNC)delete_symbols);
+    char *code = ast->expr->codeGen(ast->expr, out, state);
+    if (0 == n) {
+        free(code);
+        if (NULL != ast->def) {
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "{\n");
+            state->indent++;
+            codeGenBlock(ast->defSymbols, ast->def, out, state);
+            state->indent--;
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "}\n");
+        }
+        return NULL;
     }
-    if (NULL != ast->defSymbols) {
-        delete_Map(ast->defSymbols, (MAP_DELETE_FUNC)delete_type);
+    char *value = safe_asprintf("temp%d", state->tempCount);
+    state->tempCount++;
+    char *typeName = ast->expr->type->codeGen(ast->expr->type, value);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "%s = %s;\n", typeName, code);
+    free(typeName);
+    free(code);
+    switch (lowering(ast)) {
+        case LOWER_CHAIN:
+            codeGenChain(ast, value, out, state);
+            break;
+        case LOWER_SWITCH:
+            codeGenSwitch(ast, value, out, state);
+            break;
+        case LOWER_HASH:
+            codeGenHash(ast, value, out, state);
+            break;
+        case LOWER_TYPES:
+            codeGenTypes(ast, value, out, state);
+            break;
     }
-    free(this);
+    free(value);
+    return NULL;
 }
 
 AST *
@@ -287,13 +878,13 @@ new_ASTSwitch(YYLTYPE loc,
     struct Vector *def) {
     ASTSwitch *node;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTSwitch){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "vector.h"
 #include "parser.h"
@@ -42,51 +43,150 @@ getType(void *this, UNUSED TypeCheckState *state, Type **typeptr) {
         return 0;
     }
     //Tuple has multiple values:
+    const SparseSpan *spans = SparseVector_spans(ast->exprs);
     size_t n = SparseVector_size(ast->exprs);
     SparseVector *types = new_SparseVector(n);
     for (size_t i = 0; i < n; i++) {
-        Type *type, *type_copy;
-        AST *expr;
-        SparseVector_get(ast->exprs, i, &expr, &count);
+        Type *type;
+        AST *expr = spans[i].element;
         if (expr->getType(expr, state, &type)) {
             status = 1;
         } else {
-            type_copy = copy_type(type);
-            SparseVector_append(types, type_copy, count);
+            SparseVector_append(types, copy_type(type), spans[i].count);
         }
     }
     SparseVector_reduce(types,
         (SVEC_COMPARE_FUNC)TypeCompare,
         state,
-        (SVEC_DELETE_FUNC)delete_type);
+        NULL);
     if (0 == status) {
         *typeptr = ast->super.type = TupleType(ast->super.loc, types);
     }
     return status;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* TUPLE NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTTuple *ast = this;
+    size_t n = SparseVector_size(ast->exprs);
+    for (size_t i = 0; i < n; i++) {
+        AST *expr;
+        SparseVector_get(ast->exprs, i, &expr, NULL);
+        SparseVector_set(ast->exprs, i, expr->fold(expr, state));
+    }
+    return this;
 }
 
+/*
+ * Emit the assignment of value to the count elements of the tuple tmp
+ * starting at first. Elements in a run of the tuple's type are an inline
+ * array, which is filled by a loop.
+ */
 static void
-delete(void *this) {
+assign_elements(const struct TupleType *tuple,
+    const char *tmp,
+    ull first,
+    ull count,
+    const char *value,
+    FILE *out,
+    CodeGenState *state) {
+    size_t run = SparseVector_find(tuple->types, first);
+    const SparseSpan *spans = SparseVector_spans(tuple->types);
+    ull runFirst = 0;
+    for (size_t i = 0; i < run; i++) {
+        runFirst += spans[i].count;
+    }
+    while (0 < count) {
+        ull offset = first - runFirst,
+            left = spans[run].count - offset,
+            n = count < left
+            ? count
+            : left;
+        fprintf(out, "%*s", state->indent * 4, "");
+        if (1 == spans[run].count) {
+            fprintf(out, "%s.f%zu = %s;\n", tmp, run, value);
+        } else if (1 == n) {
+            fprintf(out, "%s.f%zu[%llu] = %s;\n", tmp, run, offset, value);
+        } else {
+            char *i = safe_asprintf("temp%d", state->tempCount);
+            state->tempCount++;
+            fprintf(out,
+                "for (size_t %s = %llu; %s < %llu; %s++) {\n",
+                i,
+                offset,
+                i,
+                offset + n,
+                i);
+            fprintf(out, "%*s", (state->indent + 1) * 4, "");
+            fprintf(out, "%s.f%zu[%s] = %s;\n", tmp, run, i, value);
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "}\n");
+            free(i);
+        }
+        first += n;
+        count -= n;
+        runFirst += spans[run].count;
+        run++;
+    }
+}
+
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTTuple *ast = this;
-    delete_SparseVector(ast->exprs, (SVEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+    if (TYPE_TUPLE != ast->super.type->type) {
+        // A tuple of a single value is the value itself.
+        AST *expr;
+        SparseVector_at(ast->exprs, 0, &expr);
+        return expr->codeGen(expr, out, state);
+    }
+    const struct TupleType *tuple = (const struct TupleType *)ast->super.type;
+    Vector_append(state->temps, ast->super.type);
+    char *tmp = safe_asprintf("temp%d", state->tempCount);
+    state->tempCount++;
+    char *typeName = tuple->super.codeGen(tuple, tmp);
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "%s;\n", typeName);
+    free(typeName);
+    size_t n = SparseVector_size(ast->exprs);
+    ull first = 0;
+    for (size_t i = 0; i < n; i++) {
+        AST *expr;
+        ull count;
+        SparseVector_get(ast->exprs, i, &expr, &count);
+        char *code = expr->codeGen(expr, out, state);
+        if (1 < count) {
+            // A repeated value is only evaluated once.
+            char *value = safe_asprintf("temp%d", state->tempCount);
+            state->tempCount++;
+            char *valueType = expr->type->codeGen(expr->type, value);
+            fprintf(out, "%*s", state->indent * 4, "");
+            fprintf(out, "%s = %s;\n", valueType, code);
+            free(valueType);
+            free(code);
+            code = value;
+        }
+        assign_elements(tuple, tmp, first, count, code, out, state);
+        free(code);
+        first += count;
+    }
+    return tmp;
+}
+
+const SparseVector *
+ASTTuple_exprs(const AST *ast) {
+    if (codeGen != ast->codeGen) {
+        return NULL;
     }
-    free(this);
+    return ((const ASTTuple *)ast)->exprs;
 }
 
 AST *
 new_ASTTuple(YYLTYPE loc, SparseVector *exprs) {
     ASTTuple *tuple = NULL;
 
-    tuple = safe_malloc(sizeof(*tuple));
+    tuple = arena_malloc(sizeof(*tuple));
     *tuple = (ASTTuple){
-        { json, getType, codeGen, delete, loc, NULL }, exprs
+        { json, getType, fold, codeGen, loc, NULL }, exprs
     };
     return (AST *)tuple;
 }
@@ -1,6 +1,7 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "types.h"
 #include "vector.h"
@@ -44,9 +45,8 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     nvars = Vector_size(ast->vars);
     for (size_t i = 0; i < nvars; i++) {
         char *name = Vector_get(ast->vars, i);
-        size_t len = strlen(name);
         Type *type_copy = copy_type(ast->super.type);
-        if (AddSymbol(state->symbols, name, len, type_copy, 1, state, &msg)) {
+        if (AddSymbol(state->symbols, name, type_copy, 1, state, &msg)) {
             print_code_error(stderr, ast->super.loc, "%s", msg);
             free(msg);
             status = 1;
@@ -55,30 +55,27 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     return status;
 }
 
+static AST *
+fold(void *this, UNUSED FoldState *state) {
+    return this;
+}
+
 static char *
 codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     return safe_strdup("/* TYPE STMT NOT IMPLEMENTED */");
 }
 
-static void
-delete(void *this) {
-    ASTTypeStmt *ast = this;
-    delete_Vector(ast->vars, free);
-    delete_type(ast->super.type);
-    free(this);
-}
-
 AST *
 new_ASTTypeStmt(YYLTYPE loc, Vector *vars, Type *type) {
     ASTTypeStmt *named_type = NULL;
 
-    named_type = safe_malloc(sizeof(*named_type));
+    named_type = arena_malloc(sizeof(*named_type));
     *named_type = (ASTTypeStmt){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             type
         },
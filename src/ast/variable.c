@@ -1,9 +1,13 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
+#include "escape.h"
 
 typedef struct ASTVariable ASTVariable;
 
@@ -28,7 +32,7 @@ static int
 getType(void *this, TypeCheckState *state, Type **typeptr) {
     ASTVariable *ast = this;
     Type *type = NULL;
-    if (Map_get(state->symbols, ast->name, strlen(ast->name), &type)) {
+    if (Scope_get(state->symbols, &ast->name, sizeof(ast->name), &type)) {
         print_code_error(stderr,
             ast->super.loc,
             "unknown variable \"%s\"",
@@ -42,43 +46,99 @@ getType(void *this, TypeCheckState *state, Type **typeptr) {
         return 1;
     }
     if (NULL != state->usedSymbols) {
-        Map_put(state->usedSymbols, ast->name, strlen(ast->name), NULL, NULL);
+        Map_put(state->usedSymbols,
+            &ast->name,
+            sizeof(ast->name),
+            NULL,
+            NULL);
     }
-    *typeptr = ast->super.type = copy_type(type);
+    Escapes_use(state->escapes, ast->name);
+    // The C variable is declared with the symbol's final type, which gains
+    // any overloads added after this use.
+    ast->super.type = type;
+    *typeptr = copy_type(type);
     return 0;
 }
 
+/*
+ * Returns the literal that every read of symbol is folded to, or NULL.
+ */
+static const AST *
+folded_value(const char *symbol, struct Map *bindings) {
+    AST *value;
+    if (Map_get(bindings, &symbol, sizeof(symbol), &value) ||
+        NULL == value) {
+        return NULL;
+    }
+    // Only unboxed values are copied, since strings are mutable objects.
+    long long int intVal;
+    double doubleVal;
+    int boolVal;
+    if (!ASTInt_value(value, &intVal) ||
+        !ASTDouble_value(value, &doubleVal) ||
+        !ASTBool_value(value, &boolVal)) {
+        return value;
+    }
+    return NULL;
+}
+
+static AST *
+fold(void *this, FoldState *state) {
+    ASTVariable *ast = this;
+    const AST *value = folded_value(ast->name, state->bindings);
+    if (NULL == value) {
+        return this;
+    }
+    long long int intVal;
+    double doubleVal;
+    int boolVal;
+    AST *ret;
+    if (!ASTInt_value(value, &intVal)) {
+        ret = ASTInt(ast->super.loc, intVal);
+    } else if (!ASTDouble_value(value, &doubleVal)) {
+        ret = ASTDouble(ast->super.loc, doubleVal);
+    } else {
+        ASTBool_value(value, &boolVal);
+        ret = ASTBool(ast->super.loc, boolVal);
+    }
+    ret->type = value->type;
+    return ret;
+}
+
 static char *
 codeGen(void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
     const ASTVariable *ast = this;
-    return safe_asprintf("%svar_%s",
+    return safe_asprintf("%s%s",
         ast->super.type->isRef
             ? "*"
             : "",
-        ast->name);
+        intern_mangled(ast->name));
 }
 
-static void
-delete(void *this) {
-    ASTVariable *ast = this;
-    free(ast->name);
-    if (NULL != ast->super.type) {
-        delete_type(ast->super.type);
+const char *
+ASTVariable_name(const AST *ast) {
+    if (codeGen != ast->codeGen) {
+        return NULL;
     }
-    free(this);
+    return ((const ASTVariable *)ast)->name;
+}
+
+int
+ASTVariable_folded(const char *symbol, struct Map *bindings) {
+    return NULL != folded_value(symbol, bindings);
 }
 
 AST *
 new_ASTVariable(YYLTYPE loc, char *name) {
     ASTVariable *variable = NULL;
 
-    variable = safe_malloc(sizeof(*variable));
+    variable = arena_malloc(sizeof(*variable));
     *variable = (ASTVariable){
         {
             json,
             getType,
+            fold,
             codeGen,
-            delete,
             loc,
             NULL
         },
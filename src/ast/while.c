@@ -1,9 +1,16 @@
 #include "ast.h"
 #include <stdlib.h>
 #include "safe.h"
+#include "arena.h"
 #include "json.h"
+#include "vector.h"
 #include "parser.h"
 #include "map.h"
+#include "scope.h"
+#include "intern.h"
+#include "escape.h"
+#include <string.h>
+#include <limits.h>
 
 typedef struct ASTWhile ASTWhile;
 
@@ -11,7 +18,10 @@ struct ASTWhile {
     AST super;
     AST *cond;
     Vector *stmts;  // Vector<AST*>
-    Map *symbols;   // NULL until type checker is executed.
+    Scope *symbols; // NULL until type checker is executed.
+    // Symbols assigned to by all but the last statement, and by the last one.
+    Map *assigned;  // Map<interned char*, NULL>
+    Map *lastAssigned;
 };
 
 static void
@@ -48,11 +58,11 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
     } else {
         const struct ObjectType *object = (const struct ObjectType *)condType;
         const struct ClassType *class = object->class;
-        const char *fieldName = "=>";
+        const char *fieldName = intern("=>");
         Type *fieldType;
         if (Map_get(class->fieldTypes,
-            fieldName,
-            strlen(fieldName),
+            &fieldName,
+            sizeof(fieldName),
             &fieldType)) {
             char *typeName = condType->toString(condType);
             print_code_error(stderr,
@@ -71,7 +81,7 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
                     *ret = (const struct ObjectType *)func->ret_type;
                 if (TYPE_OBJECT == func->ret_type->type &&
                     !ret->class->super.compare(ret->class,
-                        state->builtins[BUILTIN_BOOL],
+                        BuiltinClass(BUILTIN_BOOL, state),
                         state)) {
                     // Found right cast
                     found = 1;
@@ -90,52 +100,166 @@ getType(void *this, TypeCheckState *state, UNUSED Type **typeptr) {
             }
         }
     }
-    Map *prevSymbols = state->symbols;
+    Scope *prevSymbols = state->symbols;
     Map *prevInit = state->newInitSymbols;
     Type *prevRet = state->retType;
+    Map *prevAssigned = state->assigned;
     state->retType = NULL;
     state->newInitSymbols = NULL;
     size_t nstmts = Vector_size(ast->stmts);
     if (nstmts > 0) {
-        state->symbols = ast->symbols =
-            copy_Map(state->symbols, (MAP_COPY_FUNC)copy_type);
+        state->symbols = ast->symbols = Scope(state->symbols);
+        Vector_append(state->scopes, ast->symbols);
     }
+    state->assigned = ast->assigned = Map();
+    ast->lastAssigned = Map();
     for (size_t i = 0; i < nstmts; i++) {
         AST *stmt = Vector_get(ast->stmts, i);
         Type *type;
+        if (i + 1 == nstmts) {
+            // The last statement is usually the one that steps the counter.
+            state->assigned = ast->lastAssigned;
+        }
         if (stmt->getType(stmt, state, &type)) {
             status = 1;
         }
     }
+    if (NULL != prevAssigned) {
+        Map *maps[] = { ast->assigned, ast->lastAssigned };
+        for (size_t i = 0; i < sizeof(maps) / sizeof(*maps); i++) {
+            Iterator *it = Map_iterator(maps[i]);
+            while (it->hasNext(it)) {
+                MapIterData data = it->next(it);
+                Map_put(prevAssigned, data.key, data.len, NULL, NULL);
+            }
+            it->delete(it);
+        }
+    }
     state->symbols = prevSymbols;
     state->newInitSymbols = prevInit;
     state->retType = prevRet;
+    state->assigned = prevAssigned;
     return status;
 }
 
-static char *
-codeGen(UNUSED void *this, UNUSED FILE *out, UNUSED CodeGenState *state) {
-    return safe_strdup("/* WHILE NOT IMPLEMENTED */");
+static AST *
+fold(void *this, FoldState *state) {
+    ASTWhile *ast = this;
+    ast->cond = ast->cond->fold(ast->cond, state);
+    fold_vector(ast->stmts, state);
+    return this;
 }
 
-static void
-delete(void *this) {
+/*
+ * Returns 1 if stmt adds a non-negative int literal to the symbol counter.
+ */
+static int
+is_step(const AST *stmt, const char *counter) {
+    const AST *lhs, *rhs;
+    const char *op;
+    long long step;
+    return !ASTCall_operator(stmt, &lhs, &op, &rhs) &&
+        !strcmp(op, "+=") &&
+        ASTVariable_name(lhs) == counter &&
+        !ASTInt_value(rhs, &step) &&
+        0 <= step;
+}
+
+/*
+ * Returns the counter of the loop, or NULL if it has none, and stores its
+ * exclusive upper bound in bound. A counter is compared by the condition
+ * against an int literal, starts at a non-negative int literal defined by
+ * the statement before the loop, and only changes by being incremented by
+ * the loop's last statement. So it is in [0, bound) throughout the body.
+ */
+static const char *
+counter(const ASTWhile *ast, long long *bound, const CodeGenState *state) {
+    const AST *lhs, *rhs;
+    const char *op;
+    long long start;
+    if (ASTCall_operator(ast->cond, &lhs, &op, &rhs) ||
+        ASTInt_value(rhs, bound) ||
+        (strcmp(op, "<") && strcmp(op, "<="))) {
+        return NULL;
+    }
+    const char *var = ASTVariable_name(lhs);
+    if (NULL == var ||
+        lhs->type->isRef ||
+        Escapes_shared(state->escapes, var) ||
+        NULL == state->prev ||
+        ASTDefinition_int(state->prev, &start) != var ||
+        start < 0 ||
+        Map_contains(ast->assigned, &var, sizeof(var))) {
+        return NULL;
+    }
+    size_t nstmts = Vector_size(ast->stmts);
+    if (Map_contains(ast->lastAssigned, &var, sizeof(var)) &&
+        !is_step(Vector_get(ast->stmts, nstmts - 1), var)) {
+        return NULL;
+    }
+    if ('=' == op[1]) {
+        if (LLONG_MAX == *bound) {
+            return NULL;
+        }
+        ++*bound;
+    }
+    return var;
+}
+
+static char *
+codeGen(void *this, FILE *out, CodeGenState *state) {
     ASTWhile *ast = this;
-    delete_AST(ast->cond);
-    delete_Vector(ast->stmts, (VEC_DELETE_FUNC)delete_AST);
-    if (NULL != ast->symbols) {
-        delete_Map(ast->symbols, (MAP_DELETE_FUNC)delete_type);
+    long long bound;
+    const char *var = counter(ast, &bound, state);
+    // The condition is evaluated before every iteration, so if it takes any
+    // statements they are emitted at the top of the loop's body.
+    FILE *condOut = safe_tmpfile();
+    state->indent++;
+    char *cond = codeGenCondition(ast->cond, condOut, state);
+    state->indent--;
+    fprintf(out, "%*s", state->indent * 4, "");
+    if (0 == ftell(condOut)) {
+        fclose(condOut);
+        fprintf(out, "while (%s) {\n", cond);
+        state->indent++;
+    } else {
+        fprintf(out, "while (1) {\n");
+        copy_file(condOut, out);
+        state->indent++;
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "if (!(%s)) {\n", cond);
+        fprintf(out, "%*s", (state->indent + 1) * 4, "");
+        fprintf(out, "break;\n");
+        fprintf(out, "%*s", state->indent * 4, "");
+        fprintf(out, "}\n");
+    }
+    free(cond);
+    // Array indices in the body that the counter's bound proves safe are
+    // not checked, see codeGenIndex().
+    long long *prevBound = NULL;
+    if (NULL != var) {
+        Map_put(state->bounds, &var, sizeof(var), &bound, &prevBound);
+    }
+    codeGenBlock(ast->symbols, ast->stmts, out, state);
+    if (NULL != prevBound) {
+        Map_put(state->bounds, &var, sizeof(var), prevBound, NULL);
+    } else if (NULL != var) {
+        Map_remove(state->bounds, &var, sizeof(var), NULL);
     }
-    free(this);
+    state->indent--;
+    fprintf(out, "%*s", state->indent * 4, "");
+    fprintf(out, "}\n");
+    return NULL;
 }
 
 AST *
 new_ASTWhile(YYLTYPE loc, AST *cond, struct Vector *stmts) {
     ASTWhile *node = NULL;
 
-    node = safe_malloc(sizeof(*node));
+    node = arena_malloc(sizeof(*node));
     *node = (ASTWhile){
-        { json, getType, codeGen, delete, loc, NULL }, cond, stmts, NULL
+        { json, getType, fold, codeGen, loc, NULL }, cond, stmts, NULL, NULL,
+        NULL
     };
     return (AST *)node;
 }
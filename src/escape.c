@@ -0,0 +1,167 @@
+#include "escape.h"
+#include "types.h"
+#include "arena.h"
+#include "vector.h"
+#include "map.h"
+
+struct Uses {
+    size_t reads;
+    size_t calls; // Reads that only call the symbol
+};
+
+struct Alloc {
+    const struct FuncType *type; // NULL if not a closure
+    unsigned char inFunction : 1;
+    unsigned char nested : 1;
+    // Bound to a symbol that isn't a plain local of the allocating block
+    unsigned char nonLocal : 1;
+    Vector *symbols;             // Vector<interned char*> bound to the value
+};
+
+struct Escapes {
+    Map *uses;     // Map<interned char*, struct Uses*>
+    Map *allocs;   // Map<const AST*, struct Alloc*>
+    Map *captured; // Map<interned char*, NULL>: captured by any closure
+    // Captured by an escaping closure. NULL until Escapes_captured() is
+    // first called, which is after type checking has finished.
+    Map *escaped;  // Map<interned char*, NULL>
+};
+
+static struct Uses *
+get_uses(Escapes *this, const char *symbol) {
+    struct Uses *uses;
+    if (Map_get(this->uses, &symbol, sizeof(symbol), &uses)) {
+        uses = arena_malloc(sizeof(*uses));
+        *uses = (struct Uses){
+            0,
+            0
+        };
+        Map_put(this->uses, &symbol, sizeof(symbol), uses, NULL);
+    }
+    return uses;
+}
+
+void
+Escapes_use(Escapes *this, const char *symbol) {
+    get_uses(this, symbol)->reads++;
+}
+
+int
+Escapes_read(const Escapes *this, const char *symbol) {
+    struct Uses *uses;
+    return !Map_get(this->uses, &symbol, sizeof(symbol), &uses) &&
+        0 < uses->reads;
+}
+
+void
+Escapes_call(Escapes *this, const char *symbol) {
+    get_uses(this, symbol)->calls++;
+}
+
+void
+Escapes_bind(Escapes *this, const AST *expr, const char *symbol, int local) {
+    struct Alloc *alloc;
+    if (!Map_get(this->allocs, &expr, sizeof(expr), &alloc)) {
+        Vector_append(alloc->symbols, (char *)symbol);
+        alloc->nonLocal |= !local;
+    }
+}
+
+void
+Escapes_alloc(Escapes *this,
+    const AST *ast,
+    const struct FuncType *type,
+    int inFunction,
+    int nested) {
+    struct Alloc *alloc = arena_malloc(sizeof(*alloc));
+    *alloc = (struct Alloc){
+        type,
+        inFunction,
+        nested,
+        0,
+        Vector()
+    };
+    Map_put(this->allocs, &ast, sizeof(ast), alloc, NULL);
+    if (NULL == type) {
+        return;
+    }
+    Iterator *it = Map_iterator(type->env);
+    while (it->hasNext(it)) {
+        MapIterData data = it->next(it);
+        Map_put(this->captured, data.key, data.len, NULL, NULL);
+    }
+    it->delete(it);
+}
+
+static int
+escapes(const Escapes *this, const struct Alloc *alloc) {
+    if (alloc->nonLocal) {
+        return 1;
+    }
+    if (!alloc->inFunction && !alloc->nested) {
+        return 0;
+    }
+    size_t n = Vector_size(alloc->symbols);
+    if (NULL == alloc->type || 0 == n) {
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const char *symbol = Vector_get(alloc->symbols, i);
+        struct Uses *uses;
+        if (Map_contains(this->captured, &symbol, sizeof(symbol)) ||
+            (!Map_get(this->uses, &symbol, sizeof(symbol), &uses) &&
+                uses->reads != uses->calls)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int
+Escapes_escapes(const Escapes *this, const AST *ast) {
+    const struct Alloc *alloc;
+    if (Map_get(this->allocs, &ast, sizeof(ast), &alloc)) {
+        return 1;
+    }
+    return escapes(this, alloc);
+}
+
+int
+Escapes_captured(const Escapes *this, const char *symbol) {
+    if (NULL == this->escaped) {
+        // Computed once the analysis is complete, so it is only a cache.
+        Map *escaped = ((Escapes *)this)->escaped = Map();
+        Iterator *it = Map_iterator(this->allocs);
+        while (it->hasNext(it)) {
+            const struct Alloc *alloc = it->next(it).value;
+            if (NULL == alloc->type || !escapes(this, alloc)) {
+                continue;
+            }
+            Iterator *env = Map_iterator(alloc->type->env);
+            while (env->hasNext(env)) {
+                MapIterData data = env->next(env);
+                Map_put(escaped, data.key, data.len, NULL, NULL);
+            }
+            env->delete(env);
+        }
+        it->delete(it);
+    }
+    return Map_contains(this->escaped, &symbol, sizeof(symbol));
+}
+
+int
+Escapes_shared(const Escapes *this, const char *symbol) {
+    return Map_contains(this->captured, &symbol, sizeof(symbol));
+}
+
+Escapes *
+new_Escapes(void) {
+    Escapes *this = arena_malloc(sizeof(*this));
+    *this = (Escapes){
+        Map(),
+        Map(),
+        Map(),
+        NULL
+    };
+    return this;
+}
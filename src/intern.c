@@ -0,0 +1,133 @@
+#include "intern.h"
+#include "safe.h"
+#include "json.h"
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY 256
+
+struct Interned {
+    uint64_t hash;
+    size_t len;
+    char *mangled; // NULL until requested by intern_mangled()
+    char str[];
+};
+
+// Interned strings are bump-allocated out of their own arena so that
+// identifiers are packed together and outlive each compilation unit.
+static struct {
+    struct Interned **slots;
+    size_t capacity; // Always a power of 2
+    size_t size;
+    Arena *storage;
+} table;
+
+static struct Interned *
+entry(const char *sym) {
+    return (struct Interned *)(sym - offsetof(struct Interned, str));
+}
+
+static uint64_t
+hash(const char *str, size_t len) {
+    // 64-bit FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void
+grow(void) {
+    size_t capacity = table.capacity
+        ? table.capacity * 2
+        : INITIAL_CAPACITY;
+    struct Interned **slots = safe_calloc(capacity, sizeof(*slots));
+    for (size_t i = 0; i < table.capacity; i++) {
+        struct Interned *e = table.slots[i];
+        if (NULL != e) {
+            size_t j = e->hash & (capacity - 1);
+            while (NULL != slots[j]) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = e;
+        }
+    }
+    free(table.slots);
+    table.slots = slots;
+    table.capacity = capacity;
+}
+
+char *
+intern_n(const char *str, size_t len) {
+    if (2 * (table.size + 1) > table.capacity) {
+        grow();
+    }
+    uint64_t h = hash(str, len);
+    size_t mask = table.capacity - 1;
+    size_t i = h & mask;
+    struct Interned *e;
+    while (NULL != (e = table.slots[i])) {
+        if (e->hash == h && e->len == len && !memcmp(e->str, str, len)) {
+            return e->str;
+        }
+        i = (i + 1) & mask;
+    }
+    if (NULL == table.storage) {
+        table.storage = Arena(NULL);
+    }
+    e = Arena_alloc(table.storage, sizeof(*e) + len + 1);
+    e->hash = h;
+    e->len = len;
+    e->mangled = NULL;
+    memcpy(e->str, str, len);
+    e->str[len] = '\0';
+    table.slots[i] = e;
+    table.size++;
+    return e->str;
+}
+
+char *
+intern(const char *str) {
+    return intern_n(str, strlen(str));
+}
+
+size_t
+intern_len(const char *sym) {
+    return entry(sym)->len;
+}
+
+uint64_t
+intern_hash(const char *sym) {
+    return entry(sym)->hash;
+}
+
+const char *
+intern_mangled(const char *sym) {
+    struct Interned *e = entry(sym);
+    if (NULL == e->mangled) {
+        e->mangled = Arena_alloc(table.storage, sizeof("var_") + e->len);
+        memcpy(e->mangled, "var_", sizeof("var_") - 1);
+        memcpy(e->mangled + sizeof("var_") - 1, e->str, e->len + 1);
+    }
+    return e->mangled;
+}
+
+void
+json_symbol(const void *key, UNUSED size_t len, FILE *out) {
+    json_label(*(const char *const *)key, out);
+}
+
+void
+delete_interned(void) {
+    if (NULL != table.storage) {
+        delete_Arena(table.storage);
+    }
+    free(table.slots);
+    table.slots = NULL;
+    table.storage = NULL;
+    table.capacity = 0;
+    table.size = 0;
+}
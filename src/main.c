@@ -7,6 +7,9 @@
 #include "scanner.h"
 #include "ast.h"
 #include "safe.h"
+#include "intern.h"
+#include "types.h"
+#include "arena.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -92,6 +95,9 @@ main(int argc, char *argv[]) {
     for (int i = 0; i < file_count; i++) {
         state = yy_create_buffer(inputs[i], YY_BUF_SIZE, scanner);
         yy_switch_to_buffer(state, scanner);
+        // Everything built for this file is released at once with its arena.
+        Arena *unit = Arena(NULL);
+        Arena_enter(unit);
         AST *root = NULL;
         if (yyparse(&root, argv[optind + i], scanner)) {
             status = 1;
@@ -99,16 +105,20 @@ main(int argc, char *argv[]) {
             //Type checking, code generation, etc...
             //json_AST(root, stdout, 0);
             //fprintf(stdout, "\n");
+            Arena_enter(Arena(unit));
             if (TypeCheck(root)) {
                 print_error("type checker failed\n");
             } else {
+                root = Fold(root);
                 CodeGen(root, output);
             }
-            delete_AST(root);
         }
+        reset_canonical_types();
+        delete_Arena(unit);
         yy_delete_buffer(state, scanner);
     }
     yylex_destroy(scanner);
+    delete_interned();
     for (int i = 0; i < file_count; i++) {
         fclose(inputs[i]);
     }
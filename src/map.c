@@ -1,218 +1,348 @@
 #include "map.h"
 #include "util.h"
 #include "safe.h"
+#include "arena.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct Entry {
-    struct Entry *next;
-    void *key;
+/*
+ * Open-addressing hash table with one control byte per slot, in the style of
+ * SwissTable. Control bytes are either CTRL_EMPTY, CTRL_DELETED, or the low 7
+ * bits of a full slot's hash. Probing inspects GROUP_WIDTH control bytes at
+ * once, so most lookups touch a single 8-byte word of metadata and at most
+ * one slot. Keys up to INLINE_KEY_SIZE bytes (pointers, most identifiers) are
+ * stored inside the slot itself; longer keys get their own allocation.
+ */
+
+#define GROUP_WIDTH     8
+#define INLINE_KEY_SIZE 16
+#define CTRL_EMPTY      0x80
+#define CTRL_DELETED    0xFE
+#define MAX_LOAD_FACTOR 0.875
+
+#define LSBS 0x0101010101010101ull
+#define MSBS 0x8080808080808080ull
+
+struct Slot {
+    uint64_t hash;
     size_t len;
     void *value;
-    unsigned long hash;
+    union {
+        unsigned char bytes[INLINE_KEY_SIZE];
+        void *ptr;
+    } key;
 };
-#define Entry(key, len, value, h) new_Entry(key, len, value, h)
 
 struct Map {
-    unsigned int size;
-    unsigned int capacity;
+    unsigned char *ctrl; // NULL until the first insertion.
+    struct Slot *slots;  // NULL until the first insertion.
+    size_t capacity;     // Power of two, at least GROUP_WIDTH.
+    size_t size;
+    size_t tombstones;
     double load_factor;
-    struct Entry **entries;
+    Arena *arena;        // NULL if allocated on the heap
 };
 
 struct IteratorData {
     Map *map;
-    struct Entry *currEntry;
     size_t index;
 };
 
-static struct Entry *
-new_Entry(const void *key, size_t len, void *value, unsigned int h) {
-    struct Entry *new_entry;
-    void *new_key;
+static inline void *
+slot_key(struct Slot *slot) {
+    return slot->len <= INLINE_KEY_SIZE
+        ? slot->key.bytes
+        : slot->key.ptr;
+}
 
-    new_entry = safe_malloc(sizeof(*new_entry));
-    new_key = safe_malloc(len);
-    memcpy(new_key, key, len);
-    *new_entry = (struct Entry){
-        NULL,
-        new_key,
-        len,
-        value,
-        h
-    };
-    return new_entry;
+static inline int
+is_full(unsigned char ctrl) {
+    return 0 == (ctrl & 0x80u);
 }
 
-static int
-keycmp(const void *key1, size_t len1, const void *key2, size_t len2) {
-    const char *k1 = key1, *k2 = key2;
-    for (; len1 && len2; k1++, len1--, k2++, len2--) {
-        if (*k1 != *k2) {
-            return *k1 - *k2;
+static inline uint64_t
+mix(uint64_t h) {
+    h ^= h >> 33u;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33u;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33u;
+    return h;
+}
+
+static uint64_t
+hash(const void *key, size_t len) {
+    /* Consumes the key eight bytes at a time with a multiply-xorshift step,
+     * then finishes with the MurmurHash3 64-bit avalanche. Pointer keys and
+     * short identifiers take one or two multiplies instead of djb2's one
+     * multiply-add per byte.
+     */
+    const unsigned char *k = key;
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (len * 0xC2B2AE3D27D4EB4Full);
+    uint64_t w;
+    uint32_t lo, hi;
+    if (len > 8) {
+        for (; len > 8; k += 8, len -= 8) {
+            memcpy(&w, k, 8);
+            h = (h ^ w) * 0x9FB21C651E98DF25ull;
+            h ^= h >> 29u;
         }
+        // Final, possibly overlapping, word ends at the last byte of the key.
+        memcpy(&w, k + len - 8, 8);
+    } else if (len >= 4) {
+        memcpy(&lo, k, 4);
+        memcpy(&hi, k + len - 4, 4);
+        w = (uint64_t)hi << 32u | lo;
+    } else if (len > 0) {
+        w = (uint64_t)k[0] << 16u | (uint64_t)k[len / 2] << 8u | k[len - 1];
+    } else {
+        w = 0;
     }
-    if (len1 != len2) {
-        return (int)len1 - (int)len2;
+    h = (h ^ w) * 0x9FB21C651E98DF25ull;
+    return mix(h);
+}
+
+static inline unsigned char
+hash_ctrl(uint64_t h) {
+    return h & 0x7Fu;
+}
+
+static inline uint64_t
+load_group(const unsigned char *ctrl) {
+    uint64_t group;
+    memcpy(&group, ctrl, sizeof(group));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+    #endif
+    return group;
+}
+
+/*
+ * Each of the following returns a mask with the high bit set in every byte of
+ * the group that matches. match_ctrl() may report false positives, which are
+ * filtered out by the full hash comparison.
+ */
+static inline uint64_t
+match_ctrl(uint64_t group, unsigned char ctrl) {
+    uint64_t x = group ^ (LSBS * ctrl);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static inline uint64_t
+match_empty(uint64_t group) {
+    return group & ~(group << 6u) & MSBS;
+}
+
+static inline uint64_t
+match_empty_or_deleted(uint64_t group) {
+    return group & MSBS;
+}
+
+static inline size_t
+first_match(uint64_t mask) {
+    return __builtin_ctzll(mask) / 8;
+}
+
+/*
+ * Returns the index of the slot holding key, or map->capacity if the key is
+ * not in the map.
+ */
+static size_t
+find(const Map *map, const void *key, size_t len, uint64_t h) {
+    size_t mask = map->capacity / GROUP_WIDTH - 1;
+    size_t group = (h >> 7u) & mask;
+    unsigned char ctrl = hash_ctrl(h);
+
+    for (size_t step = 1; step <= mask + 1; step++) {
+        size_t base = group * GROUP_WIDTH;
+        uint64_t g = load_group(map->ctrl + base);
+        for (uint64_t m = match_ctrl(g, ctrl); 0 != m; m &= m - 1) {
+            size_t i = base + first_match(m);
+            struct Slot *slot = &map->slots[i];
+            if (slot->hash == h && slot->len == len &&
+                0 == memcmp(slot_key(slot), key, len)) {
+                return i;
+            }
+        }
+        if (0 != match_empty(g)) {
+            break;
+        }
+        group = (group + step) & mask;
     }
-    return 0;
+    return map->capacity;
 }
 
-static unsigned long
-hash(const void *key, size_t len) {
-    /* djb2 hash function
-     * http://www.cse.yorku.ca/~oz/hash.html
-     */
-    unsigned long hash = 5381;
-    size_t i;
-    const char *k = key;
-    for (i = 0; i < len; i++) {
-        hash = ((hash << 5u) + hash) + *k++;
+/*
+ * Returns the first empty or deleted slot on the probe sequence of hash h.
+ * The load factor guarantees one exists.
+ */
+static size_t
+find_insert_slot(const Map *map, uint64_t h) {
+    size_t mask = map->capacity / GROUP_WIDTH - 1;
+    size_t group = (h >> 7u) & mask;
+
+    for (size_t step = 1;; step++) {
+        size_t base = group * GROUP_WIDTH;
+        uint64_t m = match_empty_or_deleted(load_group(map->ctrl + base));
+        if (0 != m) {
+            return base + first_match(m);
+        }
+        group = (group + step) & mask;
     }
-    return hash;
+}
+
+static void
+allocate(Map *map, size_t capacity) {
+    map->ctrl = Arena_alloc(map->arena, capacity);
+    memset(map->ctrl, CTRL_EMPTY, capacity);
+    map->slots = Arena_alloc(map->arena, capacity * sizeof(*map->slots));
+    map->capacity = capacity;
+    map->tombstones = 0;
 }
 
 static int
-resize(Map *map, unsigned int new_capacity) {
-    struct Entry **new_entries, *curr_entry, **new_entry;
-
-    new_entries = safe_calloc(new_capacity, sizeof(*new_entries));
-    for (unsigned int i = 0; i < map->capacity; i++) {
-        for (curr_entry = map->entries[i]; NULL != curr_entry;) {
-            unsigned long h = curr_entry->hash % new_capacity;
-            for (new_entry = &new_entries[h];
-                NULL != *new_entry;
-                new_entry = &(*new_entry)->next) {
-                if (keycmp(curr_entry->key,
-                    curr_entry->len,
-                    (*new_entry)->key,
-                    (*new_entry)->len) <= 0) {
-                    break;
-                }
-            }
-            struct Entry *tmp = curr_entry->next;
-            curr_entry->next = *new_entry;
-            *new_entry = curr_entry;
-            curr_entry = tmp;
+resize(Map *map, size_t new_capacity) {
+    unsigned char *old_ctrl = map->ctrl;
+    struct Slot *old_slots = map->slots;
+    size_t old_capacity = map->capacity;
+
+    allocate(map, new_capacity);
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (is_full(old_ctrl[i])) {
+            size_t j = find_insert_slot(map, old_slots[i].hash);
+            map->ctrl[j] = hash_ctrl(old_slots[i].hash);
+            map->slots[j] = old_slots[i];
         }
     }
-    free(map->entries);
-    map->entries = new_entries;
-    map->capacity = new_capacity;
+    Arena_free(map->arena, old_ctrl);
+    Arena_free(map->arena, old_slots);
     return 0;
 }
 
+/*
+ * Ensures there is room for one more entry. Tables that are mostly
+ * tombstones are rehashed in place instead of doubling.
+ */
+static int
+reserve(Map *map) {
+    if (NULL == map->ctrl) {
+        allocate(map, map->capacity);
+        return 0;
+    }
+    double limit = map->capacity * map->load_factor;
+    if (map->size + map->tombstones + 1 <= limit) {
+        return 0;
+    }
+    if (2 * (map->size + 1) <= limit) {
+        return resize(map, map->capacity);
+    }
+    return resize(map, 2 * map->capacity);
+}
+
 int
 Map_put(Map *map, const void *key, size_t key_len, void *value, void *prev) {
-    unsigned long h;
-    struct Entry **curr_entry, *new_entry;
-
-    h = hash(key, key_len);
-    for (curr_entry = &map->entries[h % map->capacity];
-        NULL != *curr_entry;
-        curr_entry = &(*curr_entry)->next) {
-        int cmp = keycmp(key, key_len, (*curr_entry)->key, (*curr_entry)->len);
-        if (0 == cmp) {
-            if (NULL != prev) {
-                *(void **)prev = (*curr_entry)->value;
-            }
-            (*curr_entry)->value = value;
-            return 0;
-        } else if (0 > cmp) {
-            new_entry = Entry(key, key_len, value, h);
-            new_entry->next = *curr_entry;
-            *curr_entry = new_entry;
-            map->size++;
-            if ((double)map->size / map->capacity >= map->load_factor) {
-                return resize(map, 2 * map->capacity);
-            }
-            return 0;
+    uint64_t h = hash(key, key_len);
+    size_t i;
+
+    if (NULL != map->ctrl &&
+        (i = find(map, key, key_len, h)) != map->capacity) {
+        if (NULL != prev) {
+            *(void **)prev = map->slots[i].value;
         }
+        map->slots[i].value = value;
+        return 0;
     }
-    *curr_entry = Entry(key, key_len, value, h);
-    map->size++;
-    if ((double)map->size / map->capacity >= map->load_factor) {
-        return resize(map, 2 * map->capacity);
+    if (reserve(map)) {
+        return 1;
     }
+    i = find_insert_slot(map, h);
+    if (CTRL_DELETED == map->ctrl[i]) {
+        map->tombstones--;
+    }
+    struct Slot *slot = &map->slots[i];
+    slot->hash = h;
+    slot->len = key_len;
+    slot->value = value;
+    if (key_len <= INLINE_KEY_SIZE) {
+        memcpy(slot->key.bytes, key, key_len);
+    } else {
+        slot->key.ptr = Arena_alloc(map->arena, key_len);
+        memcpy(slot->key.ptr, key, key_len);
+    }
+    map->ctrl[i] = hash_ctrl(h);
+    map->size++;
     return 0;
 }
 
 int
 Map_get(Map *map, const void *key, size_t key_len, void *value) {
-    struct Entry *curr_entry;
-    unsigned long h;
-
-    h = hash(key, key_len);
-    for (curr_entry = map->entries[h % map->capacity];
-        NULL != curr_entry;
-        curr_entry = curr_entry->next) {
-        int cmp = keycmp(key, key_len, curr_entry->key, curr_entry->len);
-        if (0 == cmp) {
-            if (NULL != value) {
-                *(void **)value = curr_entry->value;
-            }
-            return 0;
-        } else if (0 > cmp) {
-            return 1;
-        }
+    if (0 == map->size) {
+        return 1;
     }
-    return 1;
+    size_t i = find(map, key, key_len, hash(key, key_len));
+    if (i == map->capacity) {
+        return 1;
+    }
+    if (NULL != value) {
+        *(void **)value = map->slots[i].value;
+    }
+    return 0;
 }
 
 int
 Map_remove(Map *map, const void *key, size_t key_len, void *prev) {
-    unsigned long h;
-    struct Entry **curr_entry, *old_entry;
-
-    h = hash(key, key_len);
-    for (curr_entry = &map->entries[h % map->capacity];
-        NULL != *curr_entry;
-        curr_entry = &(*curr_entry)->next) {
-        int cmp = keycmp(key, key_len, (*curr_entry)->key, (*curr_entry)->len);
-        if (0 == cmp) {
-            if (NULL != prev) {
-                *(void **)prev = (*curr_entry)->value;
-            }
-            old_entry = *curr_entry;
-            *curr_entry = (*curr_entry)->next;
-            free(old_entry->key);
-            free(old_entry);
-            map->size--;
-            return 0;
-        } else if (0 > cmp) {
-            return 1;
-        }
+    if (0 == map->size) {
+        return 1;
     }
-    if (NULL == *curr_entry) {
+    size_t i = find(map, key, key_len, hash(key, key_len));
+    if (i == map->capacity) {
         return 1;
     }
+    struct Slot *slot = &map->slots[i];
     if (NULL != prev) {
-        *(void **)prev = (*curr_entry)->value;
+        *(void **)prev = slot->value;
+    }
+    if (slot->len > INLINE_KEY_SIZE) {
+        Arena_free(map->arena, slot->key.ptr);
+    }
+    // If the slot's group still has an empty byte, no probe sequence has
+    // ever continued past it, so the slot can be reused as empty instead of
+    // leaving a tombstone.
+    size_t base = i - i % GROUP_WIDTH;
+    if (0 != match_empty(load_group(map->ctrl + base))) {
+        map->ctrl[i] = CTRL_EMPTY;
+    } else {
+        map->ctrl[i] = CTRL_DELETED;
+        map->tombstones++;
     }
-    old_entry = *curr_entry;
-    *curr_entry = NULL;
-    free(old_entry->key);
-    free(old_entry);
     map->size--;
     return 0;
 }
 
+size_t
+Map_size(const Map *map) {
+    return map->size;
+}
+
 void
 delete_Map(Map *this, MAP_DELETE_FUNC delete_value) {
-    for (size_t i = 0; i < this->capacity; i++) {
-        struct Entry *curr_entry = this->entries[i];
-        while (curr_entry != NULL) {
-            struct Entry *next = curr_entry->next;
-            if (NULL != delete_value) {
-                delete_value(curr_entry->value);
+    if (NULL != this->ctrl) {
+        for (size_t i = 0; i < this->capacity; i++) {
+            if (is_full(this->ctrl[i])) {
+                struct Slot *slot = &this->slots[i];
+                if (NULL != delete_value) {
+                    delete_value(slot->value);
+                }
+                if (slot->len > INLINE_KEY_SIZE) {
+                    Arena_free(this->arena, slot->key.ptr);
+                }
             }
-            free(curr_entry->key);
-            free(curr_entry);
-            curr_entry = next;
         }
+        Arena_free(this->arena, this->ctrl);
+        Arena_free(this->arena, this->slots);
     }
-    free(this->entries);
-    free(this);
+    Arena_free(this->arena, this);
 }
 
 void
@@ -223,17 +353,17 @@ json_Map(const Map *map,
     int indent) {
     json_start(out, &indent);
     int first = 1;
-    for (size_t i = 0; i < map->capacity; i++) {
-        for (struct Entry *curr = map->entries[i];
-            curr != NULL;
-            curr = curr->next) {
-            if (!first) {
-                json_comma(out, indent);
-            }
-            first = 0;
-            json_key(curr->key, curr->len, out);
-            json_value(curr->value, out, indent);
+    for (size_t i = 0; NULL != map->ctrl && i < map->capacity; i++) {
+        if (!is_full(map->ctrl[i])) {
+            continue;
         }
+        struct Slot *slot = &map->slots[i];
+        if (!first) {
+            json_comma(out, indent);
+        }
+        first = 0;
+        json_key(slot_key(slot), slot->len, out);
+        json_value(slot->value, out, indent);
     }
     json_end(out, &indent);
 }
@@ -241,79 +371,98 @@ json_Map(const Map *map,
 Map *
 copy_Map(const Map *map, MAP_COPY_FUNC copy_value) {
     Map *new_map;
-    struct Entry **entries;
+    Arena *arena = Arena_current();
 
-    new_map = safe_malloc(sizeof(*new_map));
-    entries = calloc(map->capacity, sizeof(*entries));
-    for (size_t i = 0; i < map->capacity; i++) {
-        struct Entry **new_entry = &entries[i];
-        for (struct Entry *curr = map->entries[i];
-            curr != NULL;
-            curr = curr->next) {
-            void *new_value = curr->value;
-            if (copy_value != NULL) {
-                new_value = copy_value(curr->value);
-            }
-            *new_entry = Entry(curr->key, curr->len, new_value, curr->hash);
-            new_entry = &(*new_entry)->next;
-        }
-    }
+    new_map = Arena_alloc(arena, sizeof(*new_map));
     *new_map = (Map){
-        map->size,
+        NULL,
+        NULL,
         map->capacity,
+        map->size,
+        map->tombstones,
         map->load_factor,
-        entries
+        arena
     };
+    if (NULL == map->ctrl) {
+        return new_map;
+    }
+    new_map->ctrl = Arena_alloc(arena, map->capacity);
+    memcpy(new_map->ctrl, map->ctrl, map->capacity);
+    new_map->slots = Arena_alloc(arena,
+        map->capacity * sizeof(*new_map->slots));
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (!is_full(map->ctrl[i])) {
+            continue;
+        }
+        struct Slot *slot = &new_map->slots[i];
+        *slot = map->slots[i];
+        if (slot->len > INLINE_KEY_SIZE) {
+            slot->key.ptr = Arena_alloc(arena, slot->len);
+            memcpy(slot->key.ptr, map->slots[i].key.ptr, slot->len);
+        }
+        if (NULL != copy_value) {
+            slot->value = copy_value(slot->value);
+        }
+    }
     return new_map;
 }
 
 Map *
 new_Map(unsigned int capacity, double load_factor) {
     Map *map;
-    struct Entry **entries;
+    size_t new_capacity = GROUP_WIDTH;
 
     if (capacity == 0) {
         print_ICE("cannot create Map with 0 capacity\n");
         exit(EXIT_FAILURE);
     }
-    map = safe_malloc(sizeof(*map));
-    entries = safe_calloc(capacity, sizeof(*entries));
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+    if (load_factor <= 0 || load_factor > MAX_LOAD_FACTOR) {
+        load_factor = MAX_LOAD_FACTOR;
+    }
+    Arena *arena = Arena_current();
+    map = Arena_alloc(arena, sizeof(*map));
     *map = (Map){
+        NULL,
+        NULL,
+        new_capacity,
+        0,
         0,
-        capacity,
         load_factor,
-        entries
+        arena
     };
     return map;
 }
 
+static size_t
+next_full(const Map *map, size_t index) {
+    if (NULL == map->ctrl) {
+        return map->capacity;
+    }
+    while (index < map->capacity && !is_full(map->ctrl[index])) {
+        index++;
+    }
+    return index;
+}
+
 static int
 iterator_hasNext(Iterator *it) {
-    return NULL != it->data->currEntry;
+    return it->data->index < it->data->map->capacity;
 }
 
 static MapIterData
 iterator_next(Iterator *it) {
     struct IteratorData *data = it->data;
-    if (data->currEntry == NULL) {
+    if (data->index >= data->map->capacity) {
         print_error("Iterator.next() called with no remaining values\n");
         exit(EXIT_FAILURE);
     }
-    struct Entry *ret = data->currEntry;
-    if (NULL != data->currEntry->next) {
-        data->currEntry = data->currEntry->next;
-    } else {
-        data->currEntry = NULL;
-        for (size_t i = data->index + 1; i < data->map->capacity; i++) {
-            if (NULL != data->map->entries[i]) {
-                data->currEntry = data->map->entries[i];
-                data->index = i;
-                break;
-            }
-        }
-    }
+    struct Slot *ret = &data->map->slots[data->index];
+    data->index = next_full(data->map, data->index + 1);
     return (MapIterData){
-        ret->key,
+        slot_key(ret),
         ret->len,
         ret->value
     };
@@ -328,20 +477,11 @@ iterator_delete(Iterator *it) {
 Iterator *
 Map_iterator(Map *map) {
     struct IteratorData *data;
-    struct Entry *currEntry = NULL;
-    size_t index;
-    for (index = 0; index < map->capacity; index++) {
-        if (NULL != map->entries[index]) {
-            currEntry = map->entries[index];
-            break;
-        }
-    }
 
     data = safe_malloc(sizeof(*data));
     *data = (struct IteratorData){
         map,
-        currEntry,
-        index
+        next_full(map, 0)
     };
     Iterator *it = safe_malloc(sizeof(*it));
     *it = (Iterator){
@@ -0,0 +1,282 @@
+#include "overload.h"
+#include "types.h"
+#include "arena.h"
+#include "vector.h"
+#include "map.h"
+#include <stdint.h>
+
+struct Overload {
+    struct FuncType *func;
+    size_t index; // Position in the overload list
+};
+
+DECLARE_VECTOR(OverloadVector, struct Overload)
+
+struct Bucket {
+    Type *first; // Expected type of the first argument, NULL if none
+    OverloadVector overloads;
+};
+
+struct BucketKey {
+    size_t arity;
+    const Type *first; // Canonical first argument type
+};
+
+struct Resolution {
+    struct FuncType *match;
+    int count;
+};
+
+/*
+ * The set only grows. Copies of a list share its set along with their
+ * nOverloads, and only see the overloads whose index is below it, so adding
+ * an overload to one copy doesn't change the others.
+ */
+struct OverloadSet {
+    size_t size;  // Number of overloads added
+    Map *arities; // Map<size_t, Vector<struct Bucket*>>
+    // Buckets whose first argument has a canonical type, so overloads that
+    // take the same first argument share a bucket.
+    Map *buckets; // Map<struct BucketKey, struct Bucket*>
+    // Keyed by the arity, the number of visible overloads, and then each
+    // canonical argument type with the low bit set for ref arguments.
+    Map *cache;   // Map<uintptr_t[], struct Resolution*>
+    // Keyed by the number of visible overloads and the canonical cast type.
+    Map *casts;   // Map<uintptr_t[2], struct FuncType*>, NULL if none
+};
+
+static void
+add_to_set(OverloadSet *set, struct FuncType *func) {
+    size_t arity = Vector_size(func->args);
+    Type *first = 0 == arity
+        ? NULL
+        : Vector_get(func->args, 0);
+    struct BucketKey key = {
+        arity,
+        NULL == first
+            ? NULL
+            : canonical_type(first)
+    };
+    struct Bucket *bucket;
+    if (NULL == key.first ||
+        Map_get(set->buckets, &key, sizeof(key), &bucket)) {
+        Vector *buckets;
+        if (Map_get(set->arities, &arity, sizeof(arity), &buckets)) {
+            buckets = Vector();
+            Map_put(set->arities, &arity, sizeof(arity), buckets, NULL);
+        }
+        bucket = arena_malloc(sizeof(*bucket));
+        bucket->first = first;
+        init_OverloadVector(&bucket->overloads, Arena_current(), 0);
+        Vector_append(buckets, bucket);
+        if (NULL != key.first) {
+            Map_put(set->buckets, &key, sizeof(key), bucket, NULL);
+        }
+    }
+    OverloadVector_append(&bucket->overloads, (struct Overload){
+        func,
+        set->size++
+    });
+}
+
+static OverloadSet *
+build_set(struct FuncType *head) {
+    OverloadSet *set = arena_malloc(sizeof(*set));
+    *set = (OverloadSet){
+        0,
+        Map(),
+        Map(),
+        Map(),
+        Map()
+    };
+    for (struct FuncType *func = head; NULL != func; func = func->next) {
+        add_to_set(set, func);
+    }
+    head->nOverloads = set->size;
+    return set;
+}
+
+void
+AddOverload(struct FuncType *head, struct FuncType *tail) {
+    OverloadSet *set = head->overloads;
+    if (NULL != head->last->next || NULL == set ||
+        set->size != head->nOverloads) {
+        // The list was extended through another list that shares its tail,
+        // or another copy already added overloads to the set.
+        set = NULL;
+    }
+    while (NULL != head->last->next) {
+        head->last = head->last->next;
+    }
+    head->last->next = tail;
+    for (struct FuncType *func = tail; NULL != func; func = func->next) {
+        head->last = func;
+        if (NULL != set) {
+            add_to_set(set, func);
+            head->nOverloads++;
+        }
+    }
+    if (NULL == set) {
+        head->overloads = build_set(head);
+    }
+}
+
+static int
+accepts(const Type *expectType,
+    const struct Argument *arg,
+    const Type *givenType,
+    const TypeCheckState *state) {
+    return expectType->isRef == arg->isRef &&
+        !givenType->compare(givenType, expectType, state);
+}
+
+/*
+ * Returns 1 if func takes as many arguments as were given and accepts each
+ * given argument from the start-th on.
+ */
+static int
+accepts_all(const struct FuncType *func,
+    size_t start,
+    const Vector *args,
+    const Vector *argTypes,
+    const TypeCheckState *state) {
+    size_t ngiven = Vector_size(argTypes);
+    if (Vector_size(func->args) != ngiven) {
+        return 0;
+    }
+    for (size_t i = start; i < ngiven; i++) {
+        if (!accepts(Vector_get(func->args, i),
+            Vector_get(args, i),
+            Vector_get(argTypes, i),
+            state)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int
+resolve(const struct FuncType *head,
+    const Vector *args,
+    const Vector *argTypes,
+    const TypeCheckState *state,
+    struct FuncType **match) {
+    const OverloadSet *set = head->overloads;
+    size_t ngiven = Vector_size(argTypes);
+    Vector *buckets;
+    if (Map_get(set->arities, &ngiven, sizeof(ngiven), &buckets)) {
+        return 0;
+    }
+    int count = 0;
+    size_t nbuckets = Vector_size(buckets);
+    for (size_t i = 0; i < nbuckets; i++) {
+        const struct Bucket *bucket = Vector_get(buckets, i);
+        const OverloadVector *overloads = &bucket->overloads;
+        if (overloads->items[0].index >= head->nOverloads ||
+            (0 < ngiven && !accepts(bucket->first,
+                Vector_get(args, 0),
+                Vector_get(argTypes, 0),
+                state))) {
+            continue;
+        }
+        for (size_t j = 0; j < overloads->size; j++) {
+            const struct Overload *overload = &overloads->items[j];
+            if (overload->index >= head->nOverloads) {
+                break;
+            }
+            if (!accepts_all(overload->func, 1, args, argTypes, state)) {
+                continue;
+            }
+            if (0 == count) {
+                *match = overload->func;
+            }
+            if (2 == ++count) {
+                return count;
+            }
+        }
+    }
+    return count;
+}
+
+int
+ResolveOverload(struct FuncType *head,
+    const Vector *args,
+    const Vector *argTypes,
+    const TypeCheckState *state,
+    struct FuncType **match) {
+    const OverloadSet *set = head->overloads;
+    if (NULL == set) {
+        // Never overloaded, so there's nothing to dispatch on.
+        int count = 0;
+        for (struct FuncType *func = head; NULL != func; func = func->next) {
+            if (accepts_all(func, 0, args, argTypes, state)) {
+                if (0 == count) {
+                    *match = func;
+                }
+                if (2 == ++count) {
+                    break;
+                }
+            }
+        }
+        return count;
+    }
+    size_t ngiven = Vector_size(argTypes);
+    uintptr_t key[ngiven + 2];
+    int cacheable = 1;
+    key[0] = ngiven;
+    key[1] = head->nOverloads;
+    for (size_t i = 0; i < ngiven && cacheable; i++) {
+        const struct Argument *arg = Vector_get(args, i);
+        const Type *type = canonical_type(Vector_get(argTypes, i));
+        cacheable = NULL != type;
+        key[i + 2] = (uintptr_t)type | arg->isRef;
+    }
+    struct Resolution *res;
+    if (cacheable && !Map_get(set->cache, key, sizeof(key), &res)) {
+        if (0 < res->count) {
+            *match = res->match;
+        }
+        return res->count;
+    }
+    struct FuncType *found = NULL;
+    int count = resolve(head, args, argTypes, state, &found);
+    if (cacheable) {
+        res = arena_malloc(sizeof(*res));
+        *res = (struct Resolution){
+            found,
+            count
+        };
+        Map_put(set->cache, key, sizeof(key), res, NULL);
+    }
+    if (0 < count) {
+        *match = found;
+    }
+    return count;
+}
+
+int
+ResolveCast(struct FuncType *head,
+    const Type *type,
+    const TypeCheckState *state,
+    struct FuncType **match) {
+    const OverloadSet *set = head->overloads;
+    uintptr_t key[2] = {
+        head->nOverloads,
+        (uintptr_t)canonical_type(type)
+    };
+    int cacheable = NULL != set && 0 != key[1];
+    if (cacheable && !Map_get(set->casts, key, sizeof(key), match)) {
+        return NULL == *match;
+    }
+    *match = NULL;
+    for (struct FuncType *func = head; NULL != func; func = func->next) {
+        if (!func->ret_type->compare(func->ret_type, type, state)) {
+            *match = func;
+            break;
+        }
+    }
+    if (cacheable) {
+        Map_put(set->casts, key, sizeof(key), *match, NULL);
+    }
+    return NULL == *match;
+}
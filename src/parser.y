@@ -31,6 +31,8 @@
     #include "types.h"
     #include "safe.h"
     #include "dynamic_string.h"
+    #include "intern.h"
+    #include "arena.h"
 
     # define YYLLOC_DEFAULT(Cur, Rhs, N)                            \
         do {                                                        \
@@ -328,25 +330,25 @@ UnaryExpr
   : PostfixExpr
   | T_INC PostfixExpr {
         Vector *args = init_Vector(Argument($2, 0));
-        char *name = safe_strdup("++");
+        char *name = intern("++");
         AST *func = ASTVariable(@$, name);
         $$ = ASTCall(@$, func, args);
     }
   | T_DEC PostfixExpr {
         Vector *args = init_Vector(Argument($2, 0));
-        char *name = safe_strdup("--");
+        char *name = intern("--");
         AST *func = ASTVariable(@$, name);
         $$ = ASTCall(@$, func, args);
     }
   | '-' PostfixExpr {
         Vector *args = init_Vector(Argument($2, 0));
-        char *name = safe_strdup("-");
+        char *name = intern("-");
         AST *func = ASTVariable(@$, name);
         $$ = ASTCall(@$, func, args);
     }
   | '!' PostfixExpr {
         Vector *args = init_Vector(Argument($2, 0));
-        char *name = safe_strdup("!");
+        char *name = intern("!");
         AST *func = ASTVariable(@$, name);
         $$ = ASTCall(@$, func, args);
     }
@@ -364,79 +366,79 @@ OpExpr
   : CastExpr
   | OpExpr '*' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("*");
+        char *name = intern("*");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '/' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("/");
+        char *name = intern("/");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '%' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("%");
+        char *name = intern("%");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '+' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("+");
+        char *name = intern("+");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '-' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("-");
+        char *name = intern("-");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '<' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("<");
+        char *name = intern("<");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr '>' OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup(">");
+        char *name = intern(">");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_LE OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("<=");
+        char *name = intern("<=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_GE OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup(">=");
+        char *name = intern(">=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_EQ OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("==");
+        char *name = intern("==");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_NE OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("!=");
+        char *name = intern("!=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_AND OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("&&");
+        char *name = intern("&&");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | OpExpr T_OR OpExpr {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("||");
+        char *name = intern("||");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
@@ -462,31 +464,31 @@ Expression
   : OpExpr
   | PostfixExpr T_MUL_ASSIGN Expression {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("*=");
+        char *name = intern("*=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | PostfixExpr T_DIV_ASSIGN Expression {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("/=");
+        char *name = intern("/=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | PostfixExpr T_MOD_ASSIGN Expression {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("%=");
+        char *name = intern("%=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | PostfixExpr T_ADD_ASSIGN Expression {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("+=");
+        char *name = intern("+=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
   | PostfixExpr T_SUB_ASSIGN Expression {
         Vector *args = init_Vector(Argument($3, 0));
-        char *name = safe_strdup("-=");
+        char *name = intern("-=");
         AST *method = ASTMember(@$, $1, name);
         $$ = ASTCall(@$, method, args);
     }
@@ -534,95 +536,95 @@ Fields
 
 Field
   : IdentList ':' Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = $1;
         $$->type = $3;
     }
 
 Operator
   : T_OPERATOR Binop '(' Type ')' T_ARROW Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = init_Vector($2);
         $$->type = FuncType(@$, Vector(), init_Vector($4), $7);
     }
   | T_OPERATOR Binop '(' T_IDENT ':' Type ')' T_ARROW Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = init_Vector($2);
         $$->type = FuncType(@$, Vector(), init_Vector($6), $9);
     }
   | T_OPERATOR Postop T_ARROW Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = init_Vector($2);
         $$->type = FuncType(@$, Vector(), Vector(), $4);
     }
   | T_OPERATOR T_ARROW Type {
-        $$ = safe_malloc(sizeof(*$$));
-        $$->names = init_Vector(safe_strdup("=>"));
+        $$ = arena_malloc(sizeof(*$$));
+        $$->names = init_Vector(intern("=>"));
         $$->type = FuncType(@$, Vector(), Vector(), $3);
     }
 
 Binop
   : '*' {
-        $$ = safe_strdup("*");
+        $$ = intern("*");
     }
   | '/' {
-        $$ = safe_strdup("/");
+        $$ = intern("/");
     }
   | '%' {
-        $$ = safe_strdup("%");
+        $$ = intern("%");
     }
   | '+' {
-        $$ = safe_strdup("+");
+        $$ = intern("+");
     }
   | '-' {
-        $$ = safe_strdup("-");
+        $$ = intern("-");
     }
   | '<' {
-        $$ = safe_strdup("<");
+        $$ = intern("<");
     }
   | '>' {
-        $$ = safe_strdup(">");
+        $$ = intern(">");
     }
   | T_MUL_ASSIGN {
-        $$ = safe_strdup("*=");
+        $$ = intern("*=");
     }
   | T_DIV_ASSIGN {
-        $$ = safe_strdup("/=");
+        $$ = intern("/=");
     }
   | T_MOD_ASSIGN {
-        $$ = safe_strdup("%=");
+        $$ = intern("%=");
     }
   | T_ADD_ASSIGN {
-        $$ = safe_strdup("+=");
+        $$ = intern("+=");
     }
   | T_SUB_ASSIGN {
-        $$ = safe_strdup("-=");
+        $$ = intern("-=");
     }
   | T_OR {
-        $$ = safe_strdup("||");
+        $$ = intern("||");
     }
   | T_AND {
-        $$ = safe_strdup("&&");
+        $$ = intern("&&");
     }
   | T_EQ {
-        $$ = safe_strdup("==");
+        $$ = intern("==");
     }
   | T_NE {
-        $$ = safe_strdup("!=");
+        $$ = intern("!=");
     }
   | T_LE {
-        $$ = safe_strdup("<=");
+        $$ = intern("<=");
     }
   | T_GE {
-        $$ = safe_strdup(">=");
+        $$ = intern(">=");
     }
 
 Postop
   : T_INC {
-        $$ = safe_strdup("++");
+        $$ = intern("++");
     }
   | T_DEC {
-        $$ = safe_strdup("++");
+        $$ = intern("++");
     }
 
 Constructor
@@ -742,7 +744,6 @@ ArgsOptNamed
 TypeOptNamed
   : T_IDENT ':' Type {
         $$ = $3;
-        free($1);
     }
   | T_IDENT ':' T_REF Type {
         $$ = $4;
@@ -778,12 +779,12 @@ NamedArgs
 
 NamedArg
   : IdentList ':' Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = $1;
         $$->type = $3;
     }
   | IdentList ':' T_REF Type {
-        $$ = safe_malloc(sizeof(*$$));
+        $$ = arena_malloc(sizeof(*$$));
         $$->names = $1;
         $$->type = $4;
         $$->type->isRef = 1;
@@ -0,0 +1,99 @@
+#include "scope.h"
+#include "safe.h"
+#include "arena.h"
+#include <stdlib.h>
+
+struct Scope {
+    Map *symbols;
+    Scope *parent;
+    Arena *arena; // NULL if allocated on the heap
+};
+
+int
+Scope_get(const Scope *scope, const void *key, size_t key_len, void *value) {
+    for (; NULL != scope; scope = scope->parent) {
+        if (!Map_get(scope->symbols, key, key_len, value)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int
+Scope_getLocal(const Scope *scope,
+    const void *key,
+    size_t key_len,
+    void *value) {
+    return Map_get(scope->symbols, key, key_len, value);
+}
+
+int
+Scope_declares(const Scope *scope, const void *key, size_t key_len) {
+    return Map_contains(scope->symbols, key, key_len) &&
+        Scope_get(scope->parent, key, key_len, NULL);
+}
+
+int
+Scope_put(Scope *scope,
+    const void *key,
+    size_t key_len,
+    void *value,
+    void *prev) {
+    return Map_put(scope->symbols, key, key_len, value, prev);
+}
+
+int
+Scope_own(Scope *scope,
+    const void *key,
+    size_t key_len,
+    MAP_COPY_FUNC copy_value,
+    void *value) {
+    void *val;
+    if (!Map_get(scope->symbols, key, key_len, &val)) {
+        if (NULL != value) {
+            *(void **)value = val;
+        }
+        return 0;
+    }
+    if (Scope_get(scope->parent, key, key_len, &val)) {
+        return 1;
+    }
+    val = copy_value(val);
+    Map_put(scope->symbols, key, key_len, val, NULL);
+    if (NULL != value) {
+        *(void **)value = val;
+    }
+    return 0;
+}
+
+Iterator *
+Scope_iterator(Scope *scope) {
+    return Map_iterator(scope->symbols);
+}
+
+void
+json_Scope(const Scope *scope,
+    JSON_KEY_FUNC json_key,
+    JSON_VALUE_FUNC json_value,
+    FILE *out,
+    int indent) {
+    json_Map(scope->symbols, json_key, json_value, out, indent);
+}
+
+Scope *
+new_Scope(Scope *parent) {
+    Arena *arena = Arena_current();
+    Scope *scope = Arena_alloc(arena, sizeof(*scope));
+    *scope = (Scope){
+        Map(),
+        parent,
+        arena
+    };
+    return scope;
+}
+
+void
+delete_Scope(Scope *scope, MAP_DELETE_FUNC delete_value) {
+    delete_Map(scope->symbols, delete_value);
+    Arena_free(scope->arena, scope);
+}
@@ -3,35 +3,22 @@
 #include <stdio.h>
 #include "util.h"
 #include "vector.h"
+#include "arena.h"
 
-#define REALLOC_SIZE 8
+DECLARE_VECTOR(RunVector, SparseSpan)
+DECLARE_VECTOR(CountVector, ull)
 
 struct SparseVector {
-    void **items;
-    ull *counts;
-    size_t capacity;
-    size_t size;
+    RunVector runs;
+    // ends[i] is the total count of runs 0 through i. Only the first
+    // ends.size runs are indexed; the rest are added by SparseVector_find().
+    CountVector ends;
     ull count;
 };
 
 SparseVector *
 SparseVector_append(SparseVector *this, void *element, ull count) {
-    if (this->size == this->capacity) {
-        size_t new_capacity = this->capacity + REALLOC_SIZE;
-        if (NULL == (this->items =
-            realloc(this->items, new_capacity * sizeof(*this->items)))) {
-            perror("realloc");
-            exit(EXIT_FAILURE);
-        }
-        if (NULL == (this->counts =
-            realloc(this->counts, new_capacity * sizeof(*this->counts)))) {
-            perror("realloc");
-            exit(EXIT_FAILURE);
-        }
-        this->capacity = new_capacity;
-    }
-    this->counts[this->size] = count;
-    this->items[this->size++] = element;
+    RunVector_append(&this->runs, (SparseSpan){ element, count });
     this->count += count;
     return this;
 }
@@ -41,41 +28,76 @@ SparseVector_get(const SparseVector *this,
     size_t index,
     void *element_ptr,
     ull *count_ptr) {
-    if (index >= this->size) {
+    if (index >= this->runs.size) {
         print_ICE("Invalid index passed to SparseVector get().\n");
         exit(EXIT_FAILURE);
     }
+    const SparseSpan *run = &this->runs.items[index];
     if (NULL != element_ptr) {
-        *((const void **)element_ptr) = this->items[index];
+        *((const void **)element_ptr) = run->element;
     }
     if (NULL != count_ptr) {
-        *count_ptr = this->counts[index];
+        *count_ptr = run->count;
     }
     return 0;
 }
 
+void
+SparseVector_set(SparseVector *this, size_t index, void *element) {
+    if (index >= this->runs.size) {
+        print_ICE("Invalid index passed to SparseVector set().\n");
+        exit(EXIT_FAILURE);
+    }
+    this->runs.items[index].element = element;
+}
+
+size_t
+SparseVector_find(const SparseVector *this, ull index) {
+    if (index >= this->count) {
+        print_ICE("Invalid index passed to SparseVector find().\n");
+        exit(EXIT_FAILURE);
+    }
+    // The index is a cache, so extending it doesn't change the vector.
+    CountVector *ends = (CountVector *)&this->ends;
+    ull end = 0 == ends->size
+        ? 0
+        : ends->items[ends->size - 1];
+    for (size_t i = ends->size; i < this->runs.size; i++) {
+        end += this->runs.items[i].count;
+        CountVector_append(ends, end);
+    }
+    // Find the first run that ends after index.
+    size_t lo = 0, hi = this->runs.size - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ends->items[mid] > index) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
 int
 SparseVector_at(const SparseVector *this, ull index, void *element_ptr) {
     if (element_ptr == NULL) {
         print_ICE("NULL pointer passed to SparseVector get().\n");
         exit(EXIT_FAILURE);
     }
-    size_t curr_index = 0;
-    while (this->counts[curr_index] < index) {
-        index -= this->counts[curr_index];
-        curr_index++;
-        if (curr_index >= this->size) {
-            print_ICE("Invalid index passed to SparseVector get().\n");
-            exit(EXIT_FAILURE);
-        }
-    }
-    *((const void **)element_ptr) = this->items[curr_index];
+    size_t run = SparseVector_find(this, index);
+    *((const void **)element_ptr) = this->runs.items[run].element;
     return 0;
 }
 
+const SparseSpan *
+SparseVector_spans(const SparseVector *this) {
+    return this->runs.items;
+}
+
 size_t
 SparseVector_size(const SparseVector *this) {
-    return this->size;
+    return this->runs.size;
 }
 
 unsigned long long int
@@ -85,7 +107,7 @@ SparseVector_count(const SparseVector *this) {
 
 size_t
 SparseVector_capacity(const SparseVector *this) {
-    return this->capacity;
+    return this->runs.capacity;
 }
 
 void
@@ -93,42 +115,36 @@ SparseVector_reduce(SparseVector *this,
     SVEC_COMPARE_FUNC comp,
     const void *data,
     SVEC_DELETE_FUNC delete) {
+    SparseSpan *runs = this->runs.items;
     size_t currIndex = 0;
-    for (size_t i = 1; i < this->size; i++) {
-        if (comp(this->items[currIndex], this->items[i], data)) {
+    if (0 == this->runs.size) {
+        return;
+    }
+    this->ends.size = 0;
+    for (size_t i = 1; i < this->runs.size; i++) {
+        if (comp(runs[currIndex].element, runs[i].element, data)) {
             // i and currIndex are different
             currIndex++;
-            this->items[currIndex] = this->items[i];
-            this->counts[currIndex] = this->counts[i];
+            runs[currIndex] = runs[i];
         } else {
             // i and currIndex are the same
-            this->counts[currIndex] += this->counts[i];
+            runs[currIndex].count += runs[i].count;
             if (NULL != delete) {
-                delete(this->items[i]);
+                delete(runs[i].element);
             }
         }
     }
-    this->size = currIndex + 1;
+    this->runs.size = currIndex + 1;
 }
 
 SparseVector *
 new_SparseVector(size_t size) {
     SparseVector *this;
+    Arena *arena = Arena_current();
 
-    if (NULL == (this = malloc(sizeof(*this)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (this->items = malloc(size * sizeof(*this->items)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (this->counts = malloc(size * sizeof(*this->counts)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    this->capacity = size;
-    this->size = 0;
+    this = Arena_alloc(arena, sizeof(*this));
+    init_RunVector(&this->runs, arena, size);
+    init_CountVector(&this->ends, arena, 0);
     this->count = 0;
     return this;
 }
@@ -137,65 +153,30 @@ SparseVector *
 init_SparseVector(void *element, ull count) {
     SparseVector *this;
 
-    if (NULL == (this = malloc(sizeof(*this)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (this->items = malloc(1 * sizeof(*this->items)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (this->counts = malloc(1 * sizeof(*this->counts)))) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    this->items[0] = element;
-    this->counts[0] = count;
-    this->capacity = 1;
-    this->size = 1;
-    this->count = count;
-    return this;
+    this = new_SparseVector(1);
+    return SparseVector_append(this, element, count);
 }
 
 SparseVector *
 copy_SparseVector(SparseVector *vec, SVEC_COPY_FUNC copy_value) {
-    SparseVector *new_vec;
-    void **new_items;
-    ull *new_counts;
+    SparseVector *new_vec = new_SparseVector(vec->runs.size);
 
-    if (NULL == (new_vec = malloc(sizeof(*new_vec)))) {
-        print_ICE("");
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (new_items = malloc(vec->capacity * sizeof(*new_items)))) {
-        print_ICE("");
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (new_counts = malloc(vec->capacity * sizeof(*new_counts)))) {
-        print_ICE("");
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    for (size_t i = 0; i < vec->size; i++) {
-        new_items[i] = copy_value(vec->items[i]);
-        new_counts[i] = vec->counts[i];
+    for (size_t i = 0; i < vec->runs.size; i++) {
+        const SparseSpan *run = &vec->runs.items[i];
+        SparseVector_append(new_vec, copy_value(run->element), run->count);
     }
-    *new_vec = (SparseVector){
-        new_items, new_counts, vec->capacity, vec->size, vec->count
-    };
     return new_vec;
 }
 
 void
 delete_SparseVector(SparseVector *this, void (*delete_value)(void *)) {
     if (NULL != delete_value) {
-        for (size_t i = 0; i < this->size; i++) {
-            delete_value(this->items[i]);
+        for (size_t i = 0; i < this->runs.size; i++) {
+            delete_value(this->runs.items[i].element);
         }
     }
-    free(this->items);
-    free(this->counts);
-    free(this);
+    Arena *arena = this->runs.arena;
+    clear_RunVector(&this->runs);
+    clear_CountVector(&this->ends);
+    Arena_free(arena, this);
 }
@@ -0,0 +1,213 @@
+#include "subtype.h"
+#include "types.h"
+#include "vector.h"
+#include "arena.h"
+#include "json.h"
+#include <stdlib.h>
+#include <string.h>
+
+enum Cell {
+    UNKNOWN = 0,
+    SUBTYPE,
+    NOT_SUBTYPE,
+    PENDING // Being computed, assumed to be a subtype until it finishes
+};
+
+#define CELL_BITS 2
+#define CELLS_PER_BYTE (8 / CELL_BITS)
+#define CELL_MASK ((1u << CELL_BITS) - 1)
+
+DECLARE_VECTOR(CellVector, size_t)
+
+struct SubtypeMatrix {
+    unsigned char *cells; // cells[sub * capacity + super], 2 bits each
+    size_t capacity;      // Number of class IDs with a row and column
+    size_t depth;         // Number of pairs currently PENDING
+    // SUBTYPE cells set while depth > 0. If a pending pair turns out not to
+    // be a subtype, the cells set after it started may rely on its
+    // assumption and are reset to UNKNOWN.
+    CellVector assumed;
+    Arena *arena;
+};
+
+static enum Cell
+get_cell(const SubtypeMatrix *this, size_t cell) {
+    unsigned int shift = cell % CELLS_PER_BYTE * CELL_BITS;
+    return (this->cells[cell / CELLS_PER_BYTE] >> shift) & CELL_MASK;
+}
+
+static void
+set_cell(SubtypeMatrix *this, size_t cell, enum Cell value) {
+    unsigned int shift = cell % CELLS_PER_BYTE * CELL_BITS;
+    unsigned char *byte = &this->cells[cell / CELLS_PER_BYTE];
+    *byte = (*byte & ~(CELL_MASK << shift)) | (value << shift);
+}
+
+static size_t
+bytes_for(size_t capacity) {
+    return (capacity * capacity + CELLS_PER_BYTE - 1) / CELLS_PER_BYTE;
+}
+
+static void
+grow(SubtypeMatrix *this, size_t ids) {
+    if (ids <= this->capacity) {
+        return;
+    }
+    size_t capacity = this->capacity * 2;
+    if (capacity < ids) {
+        capacity = ids;
+    }
+    SubtypeMatrix old = *this;
+    this->cells = Arena_alloc(this->arena, bytes_for(capacity));
+    this->capacity = capacity;
+    memset(this->cells, 0, bytes_for(capacity));
+    // Rows change stride, so copy cell by cell. The matrix only grows
+    // O(log n) times, each in O(n^2).
+    for (size_t i = 0; i < old.capacity; i++) {
+        for (size_t j = 0; j < old.capacity; j++) {
+            enum Cell value = get_cell(&old, i * old.capacity + j);
+            if (UNKNOWN != value) {
+                set_cell(this, i * capacity + j, value);
+            }
+        }
+    }
+    // A nested comparison can grow the matrix, so move the logged cells to
+    // the new stride as well.
+    for (size_t i = 0; i < this->assumed.size; i++) {
+        size_t cell = this->assumed.items[i];
+        this->assumed.items[i] =
+            cell / old.capacity * capacity + cell % old.capacity;
+    }
+    Arena_free(this->arena, old.cells);
+}
+
+int
+SubtypeMatrix_compare(SubtypeMatrix *this,
+    const struct ClassType *class1,
+    const struct ClassType *class2,
+    const TypeCheckState *state) {
+    if (class1 == class2) {
+        return 0;
+    }
+    if (0 == class1->id || 0 == class2->id) {
+        // Not verified yet, so it has no row to memoize in.
+        return compare_ClassType(class1, class2, state);
+    }
+    if (class1->id <= NUM_BUILTINS && class2->id <= NUM_BUILTINS) {
+        return 1;
+    }
+    size_t sub = class1->id - 1, super = class2->id - 1;
+    grow(this, (sub > super ? sub : super) + 1);
+    size_t cell = sub * this->capacity + super;
+    switch (get_cell(this, cell)) {
+        case SUBTYPE:
+        case PENDING:
+            return 0;
+        case NOT_SUBTYPE:
+            return 1;
+        case UNKNOWN:
+            break;
+    }
+    set_cell(this, cell, PENDING);
+    size_t mark = this->assumed.size;
+    this->depth++;
+    int result = compare_ClassType(class1, class2, state);
+    this->depth--;
+    // compare_ClassType() may have grown the matrix.
+    cell = sub * this->capacity + super;
+    if (result) {
+        for (size_t i = mark; i < this->assumed.size; i++) {
+            set_cell(this, this->assumed.items[i], UNKNOWN);
+        }
+        this->assumed.size = mark;
+        set_cell(this, cell, NOT_SUBTYPE);
+        return 1;
+    }
+    set_cell(this, cell, SUBTYPE);
+    if (0 < this->depth) {
+        CellVector_append(&this->assumed, cell);
+    } else {
+        this->assumed.size = 0;
+    }
+    return 0;
+}
+
+void
+SubtypeMatrix_subtypes(SubtypeMatrix *this,
+    struct ClassType *class,
+    const Vector *classes,
+    const TypeCheckState *state) {
+    if (NULL != class->subtypes) {
+        return;
+    }
+    size_t n = Vector_size(classes);
+    size_t nwords = n / 64 + 1;
+    uint64_t *subtypes = Arena_alloc(this->arena, nwords * sizeof(*subtypes));
+    memset(subtypes, 0, nwords * sizeof(*subtypes));
+    for (size_t i = 0; i < n; i++) {
+        const struct ClassType *sub = Vector_get(classes, i);
+        if (!SubtypeMatrix_compare(this, sub, class, state)) {
+            subtypes[sub->id / 64] |= (uint64_t)1 << sub->id % 64;
+        }
+    }
+    class->subtypes = subtypes;
+}
+
+static void
+json_class(const struct ClassType *class, FILE *out) {
+    char *str = class->super.toString(class);
+    json_label(str, out);
+    free(str);
+}
+
+void
+json_SubtypeMatrix(const SubtypeMatrix *this,
+    const Vector *classes,
+    FILE *out,
+    int indent) {
+    size_t n = Vector_size(classes);
+    json_start(out, &indent);
+    for (size_t i = 0; i < n; i++) {
+        const struct ClassType *class1 = Vector_get(classes, i);
+        if (0 < i) {
+            json_comma(out, indent);
+        }
+        json_class(class1, out);
+        int inner = indent, first = 1;
+        size_t sub = class1->id - 1;
+        json_start(out, &inner);
+        for (size_t j = 0; sub < this->capacity && j < n; j++) {
+            const struct ClassType *class2 = Vector_get(classes, j);
+            size_t super = class2->id - 1;
+            if (super >= this->capacity ||
+                SUBTYPE != get_cell(this, sub * this->capacity + super)) {
+                continue;
+            }
+            if (!first) {
+                json_comma(out, inner);
+            }
+            first = 0;
+            json_class(class2, out);
+            json_empty(NULL, out, inner);
+        }
+        json_end(out, &inner);
+    }
+    json_end(out, &indent);
+}
+
+SubtypeMatrix *
+new_SubtypeMatrix(void) {
+    SubtypeMatrix *this;
+    Arena *arena = Arena_current();
+
+    this = Arena_alloc(arena, sizeof(*this));
+    *this = (SubtypeMatrix){
+        NULL,
+        0,
+        0,
+        { 0 },
+        arena
+    };
+    init_CellVector(&this->assumed, arena, 0);
+    return this;
+}
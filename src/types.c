@@ -1,11 +1,15 @@
 #include <stdlib.h>
+#include <string.h>
 #include "types.h"
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
 #include "sparse_vector.h"
 #include "json.h"
 #include "ast.h"
 #include "map.h"
+#include "scope.h"
+#include "overload.h"
 #include "parser.h"
 #include "dynamic_string.h"
 
@@ -14,15 +18,202 @@ json_type(const Type *type, FILE *out, int indent) {
     type->json(type, out, indent);
 }
 
+// Map<struct CanonicalKey, Type*>, allocated on first use.
+static Map *canonicalTypes = NULL;
+
+struct CanonicalKey {
+    const struct ClassType *class; // NULL for none types
+    const char *name;
+    Types type;
+    Qualifiers qualifiers;
+    unsigned char init;
+    unsigned char isRef;
+};
+
+static Type *
+copy_canonical(const void *type) {
+    return (Type *)type;
+}
+
+static int
+verify_canonical(UNUSED void *type,
+    UNUSED const TypeCheckState *state,
+    UNUSED char **msg) {
+    // Canonical instances are only created from verified types.
+    return 0;
+}
+
+static int
+is_canonical(const Type *type) {
+    return copy_canonical == type->copy;
+}
+
+static int
+canonical_key(const Type *type, struct CanonicalKey *key, size_t *size) {
+    // Zero the padding so the key can be hashed as raw bytes.
+    memset(key, 0, sizeof(*key));
+    key->type = type->type;
+    key->qualifiers = type->qualifiers;
+    key->init = type->init;
+    key->isRef = type->isRef;
+    switch (type->type) {
+        case TYPE_OBJECT: {
+            const struct ObjectType *object = (const struct ObjectType *)type;
+            if (NULL == object->class || 0 != Vector_size(object->generics)) {
+                return 1;
+            }
+            key->class = object->class;
+            key->name = object->name;
+            *size = sizeof(struct ObjectType);
+            return 0;
+        }
+        case TYPE_NONE:
+            *size = sizeof(struct NoneType);
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static Type *
+intern_type(const Type *type) {
+    struct CanonicalKey key;
+    size_t size;
+    if (canonical_key(type, &key, &size)) {
+        return NULL;
+    }
+    if (NULL == canonicalTypes) {
+        canonicalTypes = Map();
+    }
+    Type *instance;
+    if (!Map_get(canonicalTypes, &key, sizeof(key), &instance)) {
+        return instance;
+    }
+    instance = arena_malloc(size);
+    memcpy(instance, type, size);
+    instance->copy = copy_canonical;
+    instance->verify = verify_canonical;
+    if (TYPE_OBJECT == type->type) {
+        ((struct ObjectType *)instance)->generics = Vector();
+    }
+    Map_put(canonicalTypes, &key, sizeof(key), instance, NULL);
+    return instance;
+}
+
+Type *
+canonical_type(const Type *type) {
+    if (is_canonical(type)) {
+        return (Type *)type;
+    }
+    return intern_type(type);
+}
+
+void
+reset_canonical_types(void) {
+    canonicalTypes = NULL;
+}
+
 Type *
 copy_type(Type *type) {
     return type->copy(type);
 }
 
+Type *
+copy_type_init(Type *type) {
+    Type *type_copy = type->copy(type);
+    if (type_copy->init) {
+        return type_copy;
+    }
+    if (!is_canonical(type_copy)) {
+        type_copy->init = 1;
+        return type_copy;
+    }
+    union {
+        struct ObjectType object;
+        struct NoneType none;
+    } variant;
+    size_t size = TYPE_OBJECT == type_copy->type
+        ? sizeof(struct ObjectType)
+        : sizeof(struct NoneType);
+    memcpy(&variant, type_copy, size);
+    ((Type *)&variant)->init = 1;
+    return intern_type((Type *)&variant);
+}
+
+const struct ClassType *
+BuiltinClass(enum BUILTIN_TYPE builtin, const TypeCheckState *state) {
+    size_t index = 0;
+    while (builtin >>= 1) {
+        index++;
+    }
+    return state->builtins[index];
+}
+
+Type *
+BuiltinType(enum BUILTIN_TYPE builtin, const TypeCheckState *state) {
+    struct ClassType *class =
+        (struct ClassType *)BuiltinClass(builtin, state);
+    struct CanonicalKey key;
+    memset(&key, 0, sizeof(key));
+    key.class = class;
+    key.name = class->name;
+    key.type = TYPE_OBJECT;
+    key.init = 1;
+    Type *instance;
+    if (NULL != canonicalTypes &&
+        !Map_get(canonicalTypes, &key, sizeof(key), &instance)) {
+        return instance;
+    }
+    Type *object = ObjectType(class->super.loc, class->name, Vector());
+    ((struct ObjectType *)object)->class = class;
+    object->init = 1;
+    return intern_type(object);
+}
+
+void
+BindSymbol(const TypeCheckState *state, const char *symbol, AST *value) {
+    AST *prev;
+    if (!Map_get(state->bindings, &symbol, sizeof(symbol), &prev)) {
+        value = NULL;
+    }
+    Map_put(state->bindings, &symbol, sizeof(symbol), value, NULL);
+    if (NULL != state->assigned) {
+        Map_put(state->assigned, &symbol, sizeof(symbol), NULL, NULL);
+    }
+}
+
+const struct ClassType *
+unboxed_class(const Type *type) {
+    if (TYPE_OBJECT != type->type) {
+        return NULL;
+    }
+    const struct ClassType *class = ((const struct ObjectType *)type)->class;
+    return NULL == class || NULL == class->ctype
+        ? NULL
+        : class;
+}
+
+void
+typedef_Type(const Type *type, struct Map *seen, FILE *out) {
+    switch (type->type) {
+        case TYPE_FUNC:
+            typedef_FuncType((const struct FuncType *)type, seen, out);
+            break;
+        case TYPE_TUPLE:
+            typedef_TupleType((const struct TupleType *)type, seen, out);
+            break;
+        default:
+            break;
+    }
+}
+
 int
 TypeCompare(const Type *type1,
     const Type *type2,
     const TypeCheckState *state) {
+    if (type1 == type2) {
+        return 0;
+    }
     return type1->compare(type1, type2, state);
 }
 
@@ -42,49 +233,34 @@ json_qualifier(Qualifiers value, FILE *out, int indent) {
     delete_dstring(str);
 }
 
-void
-delete_type(Type *type) {
-    type->delete(type);
-}
-
-void
-AddComparison(const struct ClassType *type, TypeCheckState *state) {
-    if (Map_contains(state->compare, &type, sizeof(type))) {
-        return;
-    }
-    Map *newCompare = Map();
-    Iterator *it = Map_iterator(state->compare);
-    while (it->hasNext(it)) {
-        MapIterData next = it->next(it);
-        Map *m = next.value;
-        struct ClassType **typePtr = next.key;
-        if (!compare_ClassType(*typePtr, type, state)) {
-            Map_put(m, &type, sizeof(type), NULL, NULL);
-        }
-        if (!compare_ClassType(type, *typePtr, state)) {
-            Map_put(newCompare, next.key, next.len, NULL, NULL);
-        }
+int
+InitSymbol(struct Scope *symbols, const void *symbol, size_t len) {
+    Type *type;
+    if (Scope_get(symbols, symbol, len, &type)) {
+        return 1;
     }
-    it->delete(it);
-    Map_put(state->compare, &type, sizeof(type), newCompare, NULL);
+    if (type->init) {
+        return 0;
+    }
+    Scope_put(symbols, symbol, len, copy_type_init(type), NULL);
+    return 0;
 }
 
 int
-AddSymbol(struct Map *symbols,
+AddSymbol(struct Scope *symbols,
     const char *symbol,
-    size_t len,
     Type *type,
     unsigned char makeCopy,
     const TypeCheckState *state,
     char **msg) {
     Type *prev_type = NULL;
-    if (Map_get(symbols, symbol, len, &prev_type)) {
+    if (Scope_get(symbols, &symbol, sizeof(symbol), &prev_type)) {
         if (makeCopy) {
             type = type->copy(type);
         }
-        Map_put(symbols, symbol, len, type, NULL);
+        Scope_put(symbols, &symbol, sizeof(symbol), type, NULL);
         if (NULL != state->newSymbols) {
-            Map_put(state->newSymbols, symbol, len, NULL, NULL);
+            Map_put(state->newSymbols, &symbol, sizeof(symbol), NULL, NULL);
         }
         return 0;
     }
@@ -92,21 +268,20 @@ AddSymbol(struct Map *symbols,
         if (makeCopy) {
             type = type->copy(type);
         }
-        struct FuncType *func1 = (struct FuncType *)prev_type,
-            *func2 = (struct FuncType *)type;
-        while (NULL != func1->next) {
-            func1 = func1->next;
-        }
-        func1->next = func2;
+        Scope_own(symbols,
+            &symbol,
+            sizeof(symbol),
+            (MAP_COPY_FUNC)copy_type,
+            &prev_type);
+        AddOverload((struct FuncType *)prev_type, (struct FuncType *)type);
         return 0;
     }
     if (type->compare(type, prev_type, state)) {
         char *oldName = prev_type->toString(prev_type),
             *newName = type->toString(type);
         *msg = safe_asprintf(
-            "redefinition of variable \"%.*s\" from type \"%s\" to type "
+            "redefinition of variable \"%s\" from type \"%s\" to type "
             "\"%s\"",
-            (int)len,
             symbol,
             oldName,
             newName);
@@ -115,9 +290,13 @@ AddSymbol(struct Map *symbols,
         return 1;
     }
     if (1 == type->init) {
-        prev_type->init = 1;
+        InitSymbol(symbols, &symbol, sizeof(symbol));
         if (NULL != state->newInitSymbols) {
-            Map_put(state->newInitSymbols, symbol, len, NULL, NULL);
+            Map_put(state->newInitSymbols,
+                &symbol,
+                sizeof(symbol),
+                NULL,
+                NULL);
         }
     }
     return 0;
@@ -1,6 +1,7 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "sparse_vector.h"
 #include "vector.h"
 
@@ -47,23 +48,28 @@ toString(const void *type) {
 }
 
 static char *
-codeGen(UNUSED const void *this, UNUSED const char *name) {
-    return NULL;
-}
-
-static void
-delete(void *type) {
-    struct ArrayType *this = type;
-    if (!this->super.isCopy) {
-        delete_type(this->type);
+codeGen(const void *this, const char *name) {
+    const struct ArrayType *type = this;
+    // Every array is the runtime's struct, see runtime/tlangrt.h.
+    if (type->super.isRef) {
+        if (NULL != name) {
+            return safe_asprintf("array *%s", name);
+        } else {
+            return safe_strdup("array *");
+        }
+    } else {
+        if (NULL != name) {
+            return safe_asprintf("array %s", name);
+        } else {
+            return safe_strdup("array");
+        }
     }
-    free(this);
 }
 
 static Type *
 copy(const void *type) {
     const struct ArrayType *this = type;
-    struct ArrayType *type_copy = safe_malloc(sizeof(*type_copy));
+    struct ArrayType *type_copy = arena_malloc(sizeof(*type_copy));
     *type_copy = (struct ArrayType){
         {
             json,
@@ -72,11 +78,9 @@ copy(const void *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_ARRAY,
             this->super.qualifiers,
             this->super.init,
-            1,
             0,
             this->super.loc
         },
@@ -89,7 +93,7 @@ Type *
 new_ArrayType(YYLTYPE loc, Type *type) {
     struct ArrayType *array;
 
-    array = safe_malloc(sizeof(*array));
+    array = arena_malloc(sizeof(*array));
     *array = (struct ArrayType){
         {
             json,
@@ -98,12 +102,10 @@ new_ArrayType(YYLTYPE loc, Type *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_ARRAY,
             0,
             0,
             0,
-            0,
             loc
         },
         type
@@ -1,8 +1,12 @@
 #include "types.h"
+#include <stdlib.h>
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
 #include "map.h"
+#include "intern.h"
+#include "subtype.h"
 #include "dynamic_string.h"
 
 static void
@@ -34,7 +38,7 @@ json(const void *type, FILE *out, int indent) {
         json_comma(out, indent);
         json_label("fields", out);
         json_Map(this->fieldTypes,
-            (JSON_KEY_FUNC)json_nlabel,
+            json_symbol,
             (JSON_VALUE_FUNC)json_type,
             out,
             indent);
@@ -54,20 +58,63 @@ compare_ClassType(const struct ClassType *class1,
         print_ICE("TypeCompare not implemented for generic objects\n");
         return 1;
     }
-    Iterator *field_it = Map_iterator(class2->fieldTypes);
-    while (field_it->hasNext(field_it)) {
-        MapIterData field = field_it->next(field_it);
-        Type *argType = NULL;
-        if (Map_get(class1->fieldTypes, field.key, field.len, &argType) ||
-            argType->compare(argType, field.value, state)) {
-            field_it->delete(field_it);
+    // class1 needs every field name of class2, so neither the fingerprint
+    // nor the count of class2 can exceed class1's.
+    if (class2->fieldMask & ~class1->fieldMask ||
+        class2->nFields > class1->nFields) {
+        return 1;
+    }
+    const struct ClassField *fields1 = class1->fieldList,
+        *end1 = fields1 + class1->nFields;
+    for (size_t i = 0; i < class2->nFields; i++) {
+        const struct ClassField *field2 = &class2->fieldList[i];
+        while (fields1 < end1 && fields1->name < field2->name) {
+            fields1++;
+        }
+        if (fields1 == end1 || fields1->name != field2->name) {
+            return 1;
+        }
+        if (fields1->type->compare(fields1->type, field2->type, state)) {
             return 1;
         }
+        fields1++;
     }
-    field_it->delete(field_it);
     return 0;
 }
 
+static uint64_t
+field_bits(const char *name) {
+    uint64_t hash = intern_hash(name);
+    return (1ull << (hash & 63)) | (1ull << (hash >> 32 & 63));
+}
+
+static int
+cmp_field(const void *a, const void *b) {
+    const char *name1 = ((const struct ClassField *)a)->name,
+        *name2 = ((const struct ClassField *)b)->name;
+    return (name1 > name2) - (name1 < name2);
+}
+
+void
+index_ClassType(struct ClassType *this) {
+    size_t n = Map_size(this->fieldTypes);
+    this->fieldMask = 0;
+    this->fieldList = arena_malloc(n * sizeof(*this->fieldList));
+    this->nFields = 0;
+    Iterator *it = Map_iterator(this->fieldTypes);
+    while (it->hasNext(it)) {
+        MapIterData field = it->next(it);
+        char *name = *(char **)field.key;
+        this->fieldList[this->nFields++] = (struct ClassField){
+            name,
+            field.value
+        };
+        this->fieldMask |= field_bits(name);
+    }
+    it->delete(it);
+    qsort(this->fieldList, n, sizeof(*this->fieldList), cmp_field);
+}
+
 static int
 compare(const void *type, const void *otherType, const TypeCheckState *state) {
     const Type *other = otherType;
@@ -79,11 +126,7 @@ compare(const void *type, const void *otherType, const TypeCheckState *state) {
         // One is a copy of the other if their pointers are the same
         return 0;
     }
-    Map *compare;
-    if (!Map_get(state->compare, &class1, sizeof(class1), &compare)) {
-        return !Map_contains(compare, &class2, sizeof(class2));
-    }
-    return compare_ClassType(class1, class2, state);
+    return SubtypeMatrix_compare(state->subtypes, class1, class2, state);
 }
 
 static int
@@ -99,16 +142,19 @@ verify(void *type, const TypeCheckState *state, char **msg) {
         size_t nNames = Vector_size(f->names);
         for (size_t j = 0; j < nNames; j++) {
             char *name = Vector_get(f->names, j);
-            if (Map_contains(this->fieldTypes, name, strlen(name))) {
+            if (Map_contains(this->fieldTypes, &name, sizeof(name))) {
                 *msg = safe_asprintf("duplicate field \"%s\"", name);
                 return 1;
             }
             Type *type_copy = f->type->copy(f->type);
-            Map_put(this->fieldTypes, name, strlen(name), type_copy, NULL);
+            Map_put(this->fieldTypes, &name, sizeof(name), type_copy, NULL);
         }
     }
-    Vector_append(state->classes, this);
-    AddComparison(type, (TypeCheckState *)state);
+    index_ClassType(this);
+    if (0 == this->id) {
+        Vector_append(state->classes, this);
+        this->id = Vector_size(state->classes);
+    }
     return 0;
 }
 
@@ -122,7 +168,7 @@ toString(const void *type) {
         MapIterData field = it->next(it);
         Type *fieldType = field.value;
         char *typeName = fieldType->toString(fieldType);
-        vappend_str(&str, "%s%.*s:%s", sep, field.len, field.key, typeName);
+        vappend_str(&str, "%s%s:%s", sep, *(char **)field.key, typeName);
         free(typeName);
         sep = ",";
     }
@@ -132,32 +178,9 @@ toString(const void *type) {
 }
 
 static char *
-codeGen(UNUSED const void *this, const char *name) {
-    if (NULL == name) {
-        return safe_strdup("closure");
-    }
-    return safe_asprintf("closure %s", name);
-}
-
-static void
-delete(UNUSED void *type) {
-}
-
-void
-delete_ClassType(struct ClassType *this) {
-    if (!this->super.isCopy) {
-        delete_Vector(this->generics, free);
-        delete_Vector(this->supers, free);
-        delete_Vector(this->fields, (VEC_DELETE_FUNC)delete_field);
-        delete_Vector(this->ctors, (VEC_DELETE_FUNC)delete_ctor);
-        if (NULL != this->fieldTypes) {
-            delete_Map(this->fieldTypes, (MAP_DELETE_FUNC)delete_type);
-        }
-        if (NULL != this->name) {
-            free(this->name);
-        }
-    }
-    free(this);
+codeGen(UNUSED const void *this, UNUSED const char *name) {
+    // Classes have no value at run time, init calls their constructors.
+    return safe_strdup("/* CLASS VALUE NOT IMPLEMENTED */");
 }
 
 static Type *
@@ -173,7 +196,7 @@ new_ClassType(YYLTYPE loc,
     struct Vector *ctors) {
     struct ClassType *type;
 
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct ClassType){
         {
             json,
@@ -182,12 +205,10 @@ new_ClassType(YYLTYPE loc,
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_CLASS,
             0,
             0,
             0,
-            0,
             loc
         },
         NULL,
@@ -195,6 +216,12 @@ new_ClassType(YYLTYPE loc,
         supers,
         fields,
         ctors,
+        NULL,
+        0,
+        NULL,
+        0,
+        0,
+        NULL,
         NULL
     };
     return (Type *)type;
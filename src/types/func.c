@@ -1,7 +1,9 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
+#include "sparse_vector.h"
 #include "dynamic_string.h"
 #include "map.h"
 
@@ -154,44 +156,217 @@ toString(const void *type) {
     return str.str;
 }
 
+static void
+mangle(const Type *type, dstring *str);
+
+/*
+ * Name a signature by its argument and return types, so that every function
+ * type with the same signature is spelled as the same C type.
+ */
+static void
+mangle_signature(const struct FuncType *func, dstring *str) {
+    append_char(str, 'F');
+    size_t nargs = Vector_size(func->args);
+    for (size_t i = 0; i < nargs; i++) {
+        mangle(Vector_get(func->args, i), str);
+    }
+    append_char(str, 'R');
+    mangle(func->ret_type, str);
+    append_char(str, 'E');
+}
+
+static void
+mangle_value(const Type *type, dstring *str) {
+    switch (type->type) {
+        case TYPE_OBJECT: {
+            const char *name = ((const struct ObjectType *)type)->name;
+            vappend_str(str, "%zu%s", strlen(name), name);
+            break;
+        }
+        case TYPE_FUNC:
+            mangle_signature((const struct FuncType *)type, str);
+            break;
+        case TYPE_TUPLE: {
+            // Runs of more than one element are spelled A<count>_<type>.
+            const SparseVector *types = ((const struct TupleType *)type)->types;
+            const SparseSpan *spans = SparseVector_spans(types);
+            size_t n = SparseVector_size(types);
+            append_char(str, 'T');
+            for (size_t i = 0; i < n; i++) {
+                if (1 < spans[i].count) {
+                    vappend_str(str, "A%llu_", spans[i].count);
+                }
+                mangle(spans[i].element, str);
+            }
+            append_char(str, 'E');
+            break;
+        }
+        case TYPE_NONE:
+            append_char(str, 'v');
+            break;
+        default:
+            append_char(str, 'x');
+            break;
+    }
+}
+
+static void
+mangle(const Type *type, dstring *str) {
+    if (type->isRef) {
+        append_char(str, 'P');
+    }
+    mangle_value(type, str);
+}
+
+char *
+mangle_Type(const Type *type) {
+    dstring str = dstring("");
+    mangle_value(type, &str);
+    return str.str;
+}
+
+/*
+ * Returns a Vector<char*> of the distinct signatures of the overloads of
+ * head, in the order they were first added. Overloads with the signature of
+ * an earlier one replace its closure, so each signature is a C closure.
+ */
+static Vector *
+signatures(const struct FuncType *head) {
+    Vector *sigs = Vector();
+    for (; NULL != head; head = head->next) {
+        dstring sig = dstring("");
+        mangle_signature(head, &sig);
+        size_t n = Vector_size(sigs);
+        size_t i = 0;
+        while (i < n && strcmp(Vector_get(sigs, i), sig.str)) {
+            i++;
+        }
+        if (i < n) {
+            free(sig.str);
+        } else {
+            Vector_append(sigs, sig.str);
+        }
+    }
+    return sigs;
+}
+
 static char *
 codeGen(const void *this, const char *name) {
     const struct FuncType *func = this;
-    if (NULL == name) {
-        if (func->super.isRef) {
-            return safe_strdup("closure *");
-        }
-        return safe_strdup("closure");
-    } else {
-        if (func->super.isRef) {
-            return safe_asprintf("closure *%s", name);
-        }
-        return safe_asprintf("closure %s", name);
+    Vector *sigs = signatures(func);
+    size_t n = Vector_size(sigs);
+    // A list of overloads is a struct with a closure for each signature.
+    dstring str = dstring(1 == n
+        ? "closure_"
+        : "overload_");
+    for (size_t i = 0; i < n; i++) {
+        append_str(&str, Vector_get(sigs, i));
     }
+    delete_Vector(sigs, free);
+    if (func->super.isRef) {
+        append_str(&str, " *");
+    } else if (NULL != name) {
+        append_char(&str, ' ');
+    }
+    if (NULL != name) {
+        append_str(&str, name);
+    }
+    return str.str;
 }
 
 static void
-delete(void *type) {
-    struct FuncType *this = type;
-    if (!this->super.isCopy) {
-        delete_Vector(this->generics, free);
-        delete_Vector(this->args, (VEC_DELETE_FUNC)delete_type);
-        delete_type(this->ret_type);
-        if (NULL != this->env) {
-            delete_Map(this->env, NULL);
+typedef_signature(const struct FuncType *this, Map *seen, FILE *out) {
+    dstring sig = dstring("");
+    mangle_signature(this, &sig);
+    if (!Map_get(seen, sig.str, strlen(sig.str), NULL)) {
+        free(sig.str);
+        return;
+    }
+    Map_put(seen, sig.str, strlen(sig.str), NULL, NULL);
+    // Types in the signature are spelled with their own typedefs.
+    size_t nargs = Vector_size(this->args);
+    for (size_t i = 0; i < nargs; i++) {
+        typedef_Type(Vector_get(this->args, i), seen, out);
+    }
+    typedef_Type(this->ret_type, seen, out);
+    char *retName = TYPE_NONE == this->ret_type->type
+        ? safe_strdup("void")
+        : this->ret_type->codeGen(this->ret_type, NULL);
+    fprintf(out, "typedef %s FUNC_%s(void *env", retName, sig.str);
+    free(retName);
+    for (size_t i = 0; i < nargs; i++) {
+        const Type *arg = Vector_get(this->args, i);
+        char *argName = arg->codeGen(arg, NULL);
+        fprintf(out, ", %s", argName);
+        free(argName);
+    }
+    fprintf(out, ");\n");
+    fprintf(out, "typedef struct closure_%s {\n", sig.str);
+    fprintf(out, "    FUNC_%s *fn;\n", sig.str);
+    fprintf(out, "    void *env;\n");
+    fprintf(out, "} closure_%s;\n", sig.str);
+    fprintf(out, "\n");
+    free(sig.str);
+}
+
+void
+typedef_FuncType(const struct FuncType *this, Map *seen, FILE *out) {
+    for (const struct FuncType *func = this; NULL != func; func = func->next) {
+        typedef_signature(func, seen, out);
+    }
+    Vector *sigs = signatures(this);
+    size_t n = Vector_size(sigs);
+    dstring name = dstring("");
+    for (size_t i = 0; i < n; i++) {
+        append_str(&name, Vector_get(sigs, i));
+    }
+    if (1 < n && Map_get(seen, name.str, strlen(name.str), NULL)) {
+        Map_put(seen, name.str, strlen(name.str), NULL, NULL);
+        fprintf(out, "typedef struct overload_%s {\n", name.str);
+        for (size_t i = 0; i < n; i++) {
+            fprintf(out,
+                "    closure_%s f%zu;\n",
+                (char *)Vector_get(sigs, i),
+                i);
         }
+        fprintf(out, "} overload_%s;\n", name.str);
+        fprintf(out, "\n");
     }
-    if (NULL != this->next) {
-        delete(this->next);
+    free(name.str);
+    delete_Vector(sigs, free);
+}
+
+int
+IsOverloaded(const Type *type) {
+    if (TYPE_FUNC != type->type) {
+        return 0;
+    }
+    Vector *sigs = signatures((const struct FuncType *)type);
+    int overloaded = 1 < Vector_size(sigs);
+    delete_Vector(sigs, free);
+    return overloaded;
+}
+
+size_t
+FindOverload(const struct FuncType *head, const struct FuncType *func) {
+    dstring sig = dstring("");
+    mangle_signature(func, &sig);
+    Vector *sigs = signatures(head);
+    size_t n = Vector_size(sigs);
+    size_t i = 0;
+    while (i + 1 < n && strcmp(Vector_get(sigs, i), sig.str)) {
+        i++;
     }
-    free(this);
+    delete_Vector(sigs, free);
+    free(sig.str);
+    return i;
 }
 
 static Type *
 copy(const void *type) {
     const struct FuncType *this = type;
     struct FuncType *next_copy = NULL;
-    struct FuncType *type_copy = safe_malloc(sizeof(*type_copy));
+    struct FuncType *type_copy = arena_malloc(sizeof(*type_copy));
     if (NULL != this->next) {
         next_copy = (struct FuncType *)copy(this->next);
     }
@@ -203,11 +378,9 @@ copy(const void *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_FUNC,
             this->super.qualifiers,
             this->super.init,
-            1,
             this->super.isRef,
             this->super.loc
         },
@@ -216,7 +389,12 @@ copy(const void *type) {
         this->args,
         this->env,
         this->ret_type,
-        next_copy
+        next_copy,
+        NULL == next_copy
+            ? type_copy
+            : next_copy->last,
+        this->nOverloads,
+        this->overloads
     };
     return (Type *)type_copy;
 }
@@ -225,7 +403,7 @@ Type *
 new_FuncType(YYLTYPE loc, Vector *generics, Vector *args, Type *ret_type) {
     struct FuncType *type;
 
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct FuncType){
         {
             json,
@@ -234,12 +412,10 @@ new_FuncType(YYLTYPE loc, Vector *generics, Vector *args, Type *ret_type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_FUNC,
             0,
             0,
             0,
-            0,
             loc
         },
         NULL,
@@ -247,6 +423,9 @@ new_FuncType(YYLTYPE loc, Vector *generics, Vector *args, Type *ret_type) {
         args,
         NULL,
         ret_type,
+        NULL,
+        type,
+        1,
         NULL
     };
     return (Type *)type;
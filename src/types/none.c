@@ -1,6 +1,7 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
 
 static void
@@ -45,41 +46,16 @@ codeGen(UNUSED const void *this, UNUSED const char *name) {
     return NULL;
 }
 
-static void
-delete(void *type) {
-    struct NoneType *this = type;
-    free(this);
-}
-
 static Type *
 copy(const void *type) {
-    const struct NoneType *this = type;
-    struct NoneType *type_copy = safe_malloc(sizeof(*type_copy));
-    *type_copy = (struct NoneType){
-        {
-            json,
-            copy,
-            compare,
-            verify,
-            toString,
-            codeGen,
-            delete,
-            TYPE_NONE,
-            this->super.qualifiers,
-            this->super.init,
-            1,
-            this->super.isRef,
-            this->super.loc
-        }
-    };
-    return (Type *)type_copy;
+    return canonical_type(type);
 }
 
 Type *
 new_NoneType(YYLTYPE loc) {
     struct NoneType *type;
 
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct NoneType){
         {
             json,
@@ -88,12 +64,10 @@ new_NoneType(YYLTYPE loc) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_NONE,
             0,
             0,
             0,
-            0,
             loc
         }
     };
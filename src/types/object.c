@@ -1,8 +1,10 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "vector.h"
 #include "map.h"
+#include "scope.h"
 
 static void
 json(const void *type, FILE *out, int indent) {
@@ -27,6 +29,9 @@ json(const void *type, FILE *out, int indent) {
 static int
 compare(const void *type, const void *otherType, const TypeCheckState *state) {
     const Type *other = otherType;
+    if (type == otherType) {
+        return 0;
+    }
     if (TYPE_OBJECT != other->type) {
         return 1;
     }
@@ -46,9 +51,8 @@ static int
 verify(void *type, const TypeCheckState *state, char **msg) {
     struct ObjectType *object = type;
     char *name = object->name;
-    size_t len = strlen(name);
     struct ClassType *classType = NULL;
-    if (Map_get(state->symbols, name, len, &classType)) {
+    if (Scope_get(state->symbols, &name, sizeof(name), &classType)) {
         if (NULL != msg) {
             *msg = safe_asprintf("unknown type \"%s\"", name);
         }
@@ -80,6 +84,19 @@ toString(const void *type) {
 static char *
 codeGen(const void *this, const char *name) {
     const struct ObjectType *type = this;
+    const struct ClassType *class = unboxed_class(this);
+    if (NULL != class) {
+        const char *ptr = type->super.isRef
+            ? "*"
+            : "";
+        if (NULL != name) {
+            return safe_asprintf("%s %s%s", class->ctype, ptr, name);
+        } else if (type->super.isRef) {
+            return safe_asprintf("%s *", class->ctype);
+        } else {
+            return safe_strdup(class->ctype);
+        }
+    }
     if (type->super.isRef) {
         if (NULL != type->class->name) {
             if (NULL != name) {
@@ -103,20 +120,14 @@ codeGen(const void *this, const char *name) {
     }
 }
 
-static void
-delete(void *type) {
-    struct ObjectType *this = type;
-    if (!this->super.isCopy) {
-        free(this->name);
-        delete_Vector(this->generics, free);
-    }
-    free(this);
-}
-
 static Type *
 copy(const void *type) {
     const struct ObjectType *this = type;
-    struct ObjectType *type_copy = safe_malloc(sizeof(*type_copy));
+    Type *canonical = canonical_type(type);
+    if (NULL != canonical) {
+        return canonical;
+    }
+    struct ObjectType *type_copy = arena_malloc(sizeof(*type_copy));
     *type_copy = (struct ObjectType){
         {
             json,
@@ -125,11 +136,9 @@ copy(const void *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_OBJECT,
             this->super.qualifiers,
             this->super.init,
-            1,
             this->super.isRef,
             this->super.loc
         },
@@ -144,7 +153,7 @@ Type *
 new_ObjectType(YYLTYPE loc, char *name, struct Vector *generics) {
     struct ObjectType *type;
 
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct ObjectType){
         {
             json,
@@ -153,12 +162,10 @@ new_ObjectType(YYLTYPE loc, char *name, struct Vector *generics) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_OBJECT,
             0,
             0,
             0,
-            0,
             loc
         },
         name,
@@ -1,6 +1,7 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "sparse_vector.h"
 #include "vector.h"
 #include "dynamic_string.h"
@@ -73,16 +74,10 @@ codeGen(UNUSED const void *this, UNUSED const char *name) {
     return NULL;
 }
 
-static void
-delete(void *type) {
-    struct SpreadType *this = type;
-    free(this);
-}
-
 static Type *
 copy(const void *type) {
     const struct SpreadType *this = type;
-    struct SpreadType *type_copy = safe_malloc(sizeof(*type_copy));
+    struct SpreadType *type_copy = arena_malloc(sizeof(*type_copy));
     *type_copy = (struct SpreadType){
         {
             json,
@@ -91,11 +86,9 @@ copy(const void *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_SPREAD,
             this->super.qualifiers,
             this->super.init,
-            1,
             this->super.isRef,
             this->super.loc
         },
@@ -108,7 +101,7 @@ Type *
 new_SpreadType(struct TupleType *tuple) {
     struct SpreadType *type;
 
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct SpreadType){
         {
             json,
@@ -117,12 +110,10 @@ new_SpreadType(struct TupleType *tuple) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_SPREAD,
             0,
             0,
             0,
-            0,
             tuple->super.loc
         },
         tuple->types
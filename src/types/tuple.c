@@ -1,9 +1,12 @@
 #include "types.h"
 #include "json.h"
 #include "safe.h"
+#include "arena.h"
 #include "sparse_vector.h"
 #include "vector.h"
 #include "dynamic_string.h"
+#include "map.h"
+#include <string.h>
 
 static void
 json(const void *type, FILE *out, int indent) {
@@ -31,45 +34,51 @@ compare(UNUSED const void *type,
         return 1;
     }
     const struct TupleType *type1 = type, *type2 = otherType;
-    ull count1 = SparseVector_count(type1->types),
-        count2 = SparseVector_count(type2->types);
-    size_t s1 = SparseVector_size(type1->types),
-        s2 = SparseVector_size(type2->types);
-    if (count1 != count2) {
+    if (SparseVector_count(type1->types) != SparseVector_count(type2->types)) {
         return 1;
     }
-    if (count1 == 0) {
-        return 0;
-    }
-    Type *currType1 = NULL, *currType2 = NULL;
-    ull currCount1 = 0, currCount2 = 0;
+    const SparseSpan *spans1 = SparseVector_spans(type1->types),
+        *spans2 = SparseVector_spans(type2->types);
+    size_t s1 = SparseVector_size(type1->types),
+        s2 = SparseVector_size(type2->types);
+    // Walk both run lists together, comparing each overlapping pair of runs
+    // once no matter how many elements they cover.
     size_t index1 = 0, index2 = 0;
-    do {
-        if (currCount1 < currCount2) {
-            currCount2 -= currCount1;
-            SparseVector_get(type1->types, index1++, &currType1, &currCount1);
-        } else if (currCount2 < currCount1) {
-            currCount1 -= currCount2;
-            SparseVector_get(type2->types, index2++, &currType2, &currCount2);
-        } else {
-            SparseVector_get(type1->types, index1++, &currType1, &currCount1);
-            SparseVector_get(type2->types, index2++, &currType2, &currCount2);
+    ull used1 = 0, used2 = 0;
+    while (index1 < s1 && index2 < s2) {
+        if (used1 == spans1[index1].count) {
+            index1++;
+            used1 = 0;
+            continue;
+        }
+        if (used2 == spans2[index2].count) {
+            index2++;
+            used2 = 0;
+            continue;
         }
-        if (currType1->compare(currType1, currType2, state)) {
+        const Type *elem1 = spans1[index1].element,
+            *elem2 = spans2[index2].element;
+        if (elem1->compare(elem1, elem2, state)) {
             return 1;
         }
-    } while (index1 < s1 && index2 < s2);
-
+        ull left1 = spans1[index1].count - used1,
+            left2 = spans2[index2].count - used2,
+            step = left1 < left2
+            ? left1
+            : left2;
+        used1 += step;
+        used2 += step;
+    }
     return 0;
 }
 
 static int
 verify(void *type, const struct TypeCheckState *state, char **msg) {
     struct TupleType *tuple = type;
+    const SparseSpan *spans = SparseVector_spans(tuple->types);
     size_t n = SparseVector_size(tuple->types);
     for (size_t i = 0; i < n; i++) {
-        Type *t;
-        SparseVector_get(tuple->types, i, &t, NULL);
+        Type *t = spans[i].element;
         if (t->verify(t, state, msg)) {
             return 1;
         }
@@ -77,7 +86,7 @@ verify(void *type, const struct TypeCheckState *state, char **msg) {
     SparseVector_reduce(tuple->types,
         (SVEC_COMPARE_FUNC)TypeCompare,
         state,
-        (SVEC_DELETE_FUNC)delete_type);
+        NULL);
     return 0;
 }
 
@@ -86,11 +95,11 @@ toString(const void *type) {
     const struct TupleType *this = type;
     dstring str = dstring("(");
     char *sep = "";
+    const SparseSpan *spans = SparseVector_spans(this->types);
     size_t n = SparseVector_size(this->types);
     for (size_t i = 0; i < n; i++) {
-        Type *t;
-        unsigned long long c;
-        SparseVector_get(this->types, i, &t, &c);
+        const Type *t = spans[i].element;
+        ull c = spans[i].count;
         char *s = t->toString(t);
         vappend_str(&str, "%s%s", sep, s);
         free(s);
@@ -104,23 +113,77 @@ toString(const void *type) {
 }
 
 static char *
-codeGen(UNUSED const void *this, UNUSED const char *name) {
-    return NULL;
+codeGen(const void *this, const char *name) {
+    const struct TupleType *tuple = this;
+    char *mangled = mangle_Type(this);
+    char *str;
+    if (tuple->super.isRef) {
+        if (NULL != name) {
+            str = safe_asprintf("tuple_%s *%s", mangled, name);
+        } else {
+            str = safe_asprintf("tuple_%s *", mangled);
+        }
+    } else {
+        if (NULL != name) {
+            str = safe_asprintf("tuple_%s %s", mangled, name);
+        } else {
+            str = safe_asprintf("tuple_%s", mangled);
+        }
+    }
+    free(mangled);
+    return str;
 }
 
-static void
-delete(void *type) {
-    struct TupleType *this = type;
-    if (!this->super.isCopy) {
-        delete_SparseVector(this->types, (VEC_DELETE_FUNC)delete_type);
+void
+typedef_TupleType(const struct TupleType *this, Map *seen, FILE *out) {
+    char *name = mangle_Type((const Type *)this);
+    if (!Map_get(seen, name, strlen(name), NULL)) {
+        free(name);
+        return;
+    }
+    Map_put(seen, name, strlen(name), NULL, NULL);
+    const SparseSpan *spans = SparseVector_spans(this->types);
+    size_t n = SparseVector_size(this->types);
+    for (size_t i = 0; i < n; i++) {
+        typedef_Type(spans[i].element, seen, out);
+    }
+    fprintf(out, "typedef struct tuple_%s {\n", name);
+    for (size_t i = 0; i < n; i++) {
+        const Type *type = spans[i].element;
+        char *field = 1 < spans[i].count
+            ? safe_asprintf("f%zu[%llu]", i, spans[i].count)
+            : safe_asprintf("f%zu", i);
+        char *decl = type->codeGen(type, field);
+        fprintf(out, "    %s;\n", decl);
+        free(decl);
+        free(field);
+    }
+    fprintf(out, "} tuple_%s;\n", name);
+    fprintf(out, "\n");
+    free(name);
+}
+
+char *
+TupleType_field(const struct TupleType *this,
+    const char *value,
+    unsigned long long index) {
+    size_t run = SparseVector_find(this->types, index);
+    const SparseSpan *spans = SparseVector_spans(this->types);
+    if (1 == spans[run].count) {
+        return safe_asprintf("(%s).f%zu", value, run);
+    }
+    // The run's first index is the sum of the counts of the runs before it.
+    unsigned long long first = 0;
+    for (size_t i = 0; i < run; i++) {
+        first += spans[i].count;
     }
-    free(this);
+    return safe_asprintf("(%s).f%zu[%llu]", value, run, index - first);
 }
 
 static Type *
 copy(const void *type) {
     const struct TupleType *this = type;
-    struct TupleType *type_copy = safe_malloc(sizeof(*type_copy));
+    struct TupleType *type_copy = arena_malloc(sizeof(*type_copy));
     *type_copy = (struct TupleType){
         {
             json,
@@ -129,11 +192,9 @@ copy(const void *type) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_TUPLE,
             this->super.qualifiers,
             this->super.init,
-            1,
             this->super.isRef,
             this->super.loc
         },
@@ -145,7 +206,7 @@ copy(const void *type) {
 Type *
 new_TupleType(YYLTYPE loc, struct SparseVector *types) {
     struct TupleType *type;
-    type = safe_malloc(sizeof(*type));
+    type = arena_malloc(sizeof(*type));
     *type = (struct TupleType){
         {
             json,
@@ -154,12 +215,10 @@ new_TupleType(YYLTYPE loc, struct SparseVector *types) {
             verify,
             toString,
             codeGen,
-            delete,
             TYPE_TUPLE,
             0,
             0,
             0,
-            0,
             loc
         },
         types
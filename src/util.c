@@ -2,6 +2,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include "parser.h"
 
 int
@@ -141,10 +142,39 @@ strident(const char *str, char *buf) {
     while (*str != '\0') {
         if ((*str >= 'a' && *str <= 'z') || (*str >= 'A' && *str <= 'Z') ||
             (*str >= '0' && *str <= '9') || *str == '_') {
-            *curr = *str;
+            *curr++ = *str;
         } else {
-            curr += sprintf(curr, "%X", *str);
+            curr += sprintf(curr, "%X", (unsigned char)*str);
         }
         str++;
     }
+    *curr = '\0';
+}
+
+void
+fprint_c_string(FILE *out, const char *str) {
+    fprintf(out, "\"");
+    for (; '\0' != *str; str++) {
+        unsigned char c = *str;
+        if ('"' == c || '\\' == c || '?' == c) {
+            // ? is escaped so that it can't start a trigraph.
+            fprintf(out, "\\%c", c);
+        } else if (isprint(c)) {
+            fprintf(out, "%c", c);
+        } else {
+            fprintf(out, "\\%03o", c);
+        }
+    }
+    fprintf(out, "\"");
+}
+
+void
+copy_file(FILE *tmp, FILE *out) {
+    char buf[BUFSIZ];
+    size_t len;
+    rewind(tmp);
+    while (0 < (len = fread(buf, 1, sizeof(buf), tmp))) {
+        fwrite(buf, 1, len, out);
+    }
+    fclose(tmp);
 }
@@ -1,23 +1,59 @@
 #include "vector.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "util.h"
 #include "safe.h"
-
-#define REALLOC_SIZE 8
+#include "arena.h"
 
 struct Vector {
-    void **items;
+    void **items; // Points to inline_items until it outgrows them
     size_t capacity;
     size_t size;
+    Arena *arena; // NULL if allocated on the heap
+    void *inline_items[VECTOR_INLINE_SIZE];
 };
 
+void *
+vector_grow(void *items,
+    const void *inline_items,
+    size_t *capacity,
+    size_t elem_size,
+    Arena *arena) {
+    // Grow geometrically, so appends are amortized O(1) and the blocks an
+    // arena abandons along the way add up to less than the final size.
+    size_t new_capacity = *capacity * 2;
+    void *new_items;
+    if (items == inline_items) {
+        new_items = Arena_alloc(arena, new_capacity * elem_size);
+        memcpy(new_items, items, *capacity * elem_size);
+    } else {
+        new_items = Arena_realloc(arena,
+            items,
+            *capacity * elem_size,
+            new_capacity * elem_size);
+    }
+    *capacity = new_capacity;
+    return new_items;
+}
+
+void
+vector_index_error(const char *name, size_t index, size_t size) {
+    print_ICE("Invalid index %zu passed to %s of size %zu.\n",
+        index,
+        name,
+        size);
+    exit(EXIT_FAILURE);
+}
+
 Vector *
 Vector_append(Vector *this, void *element) {
     if (this->size == this->capacity) {
-        size_t new_capacity = this->capacity + REALLOC_SIZE;
-        this->items = safe_realloc(this->items, new_capacity * sizeof(void *));
-        this->capacity = new_capacity;
+        this->items = vector_grow(this->items,
+            this->inline_items,
+            &this->capacity,
+            sizeof(void *),
+            this->arena);
     }
     this->items[this->size++] = element;
     return this;
@@ -32,6 +68,15 @@ Vector_get(const Vector *this, size_t index) {
     return this->items[index];
 }
 
+void
+Vector_set(Vector *this, size_t index, void *element) {
+    if (index >= this->size) {
+        print_ICE("Invalid index passed to Vector set().\n");
+        exit(EXIT_FAILURE);
+    }
+    this->items[index] = element;
+}
+
 size_t
 Vector_size(const Vector *this) {
     return this->size;
@@ -55,11 +100,18 @@ Vector_clear(Vector *this, VEC_DELETE_FUNC delete_value) {
 Vector *
 new_Vector(size_t size) {
     Vector *this;
+    Arena *arena = Arena_current();
 
-    this = safe_malloc(sizeof(*this));
-    *this = (Vector){
-        safe_malloc(size * sizeof(void *)), size, 0
-    };
+    this = Arena_alloc(arena, sizeof(*this));
+    this->capacity = VECTOR_INLINE_SIZE;
+    this->size = 0;
+    this->arena = arena;
+    if (size > VECTOR_INLINE_SIZE) {
+        this->items = Arena_alloc(arena, size * sizeof(void *));
+        this->capacity = size;
+    } else {
+        this->items = this->inline_items;
+    }
     return this;
 }
 
@@ -67,10 +119,8 @@ Vector *
 init_Vector(void *element) {
     Vector *this;
 
-    this = safe_malloc(sizeof(*this));
-    this->items = malloc(sizeof(*this->items));
+    this = new_Vector(1);
     this->items[0] = element;
-    this->capacity = 1;
     this->size = 1;
     return this;
 }
@@ -82,25 +132,12 @@ sort_Vector(Vector *vec, VEC_COMPARATOR comparator) {
 
 Vector *
 copy_Vector(const Vector *vec, VEC_COPY_FUNC copy_value) {
-    Vector *new_vec;
-    void **new_items;
+    Vector *new_vec = new_Vector(vec->size);
 
-    if (NULL == (new_vec = malloc(sizeof(*new_vec)))) {
-        print_ICE("");
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    if (NULL == (new_items = malloc(vec->capacity * sizeof(*new_items)))) {
-        print_ICE("");
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
     for (size_t i = 0; i < vec->size; i++) {
-        new_items[i] = copy_value(vec->items[i]);
+        new_vec->items[i] = copy_value(vec->items[i]);
     }
-    *new_vec = (Vector){
-        new_items, vec->capacity, vec->size
-    };
+    new_vec->size = vec->size;
     return new_vec;
 }
 
@@ -111,6 +148,8 @@ delete_Vector(Vector *this, void (*delete_value)(void *)) {
             delete_value(this->items[i]);
         }
     }
-    free(this->items);
-    free(this);
+    if (this->items != this->inline_items) {
+        Arena_free(this->arena, this->items);
+    }
+    Arena_free(this->arena, this);
 }
@@ -0,0 +1,11 @@
+/*
+A loop whose bound is past the end of the array keeps the bounds check, and
+it stops the program at the first index out of bounds.
+*/
+// expect-fail: array index 10 is out of bounds for length 10
+a = new int[10];
+k = 0;
+while k < 11 {
+    x = a[k];
+    k += 1;
+}
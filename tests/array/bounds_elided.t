@@ -0,0 +1,31 @@
+/*
+An array's elements are stored unboxed in one buffer. Indexing by the
+counter of a while loop whose bound is at most the array's length needs no
+bounds check, whether the element is read or updated.
+*/
+// expect-c: \(\(int64_t \*\)\(var_a\)->data\)\[var_i\] \+= var_i
+// expect-c: var_sum \+= \(\(int64_t \*\)\(var_a\)->data\)\[var_j\]
+// expect-c: var_ok = \(\(unsigned char \*\)\(var_flags\)->data\)\[var_m\]
+a = new int[10];
+i = 0;
+while i < 10 {
+    a[i] += i;
+    i += 1;
+}
+sum = 0;
+j = 0;
+while j <= 9 {
+    sum += a[j];
+    j += 1;
+}
+flags = new bool[4];
+ok = true;
+m = 0;
+while m < 4 {
+    ok = flags[m];
+    m += 2;
+}
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[sum - 45];
+z = check[ok => int];
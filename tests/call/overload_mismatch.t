@@ -0,0 +1,12 @@
+/*
+A call that matches no overload of its arity is rejected, even if an
+overload of another arity takes its arguments' types.
+*/
+// expect-error: no matching function call with argument types \(string, int\)
+// expect-error: no matching function call with argument type \(bool\)
+f = func(x: string) => int { return 1; };
+f = func(x: int, y: int) => int { return x + y; };
+f = func(x: int) => int { return x; };
+a = f(3, 4);
+b = f("s", 4);
+c = f(true);
@@ -0,0 +1,14 @@
+/*
+Binding a symbol to functions of different signatures overloads it. A call
+is dispatched on its arity, then on the types of its arguments.
+*/
+f = func() => int { return 1; };
+f = func(x: int) => int { return x * 10; };
+f = func(x: string) => int { return ((x == "s") => int) * 100; };
+f = func(x: int, y: int) => int { return x + y; };
+f = func(x: double, y: int) => int { return ((x * 1000.) => int) - y; };
+f = func(x: int, y: int, z: int) => int { return x * y * z; };
+n = f() + f(2) + f("s") + f(3, 4) + f(1.5, 1) + f(2, 3, 4);
+// Indexing out of bounds exits with an error unless n == 1651.
+check = new int[1];
+z = check[n - 1651];
@@ -0,0 +1,44 @@
+/*
+If, while and do become the C statements, testing their unboxed bool
+conditions directly.
+*/
+// expect-c: while \(1\) {
+// expect-c: do {
+// expect-c: } while \(1\)
+// expect-c: if \(temp[0-9]+\) {
+// expect-c: } else {
+// expect-no-c: ->val
+collatz = func(n: int) => int {
+    steps = 0;
+    while n != 1 {
+        if n - n / 2 * 2 == 0 {
+            n /= 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        steps += 1;
+    }
+    return steps;
+};
+sign = func(x: int) => int {
+    if x < 0 {
+        return -1;
+    } else if x == 0 {
+        return 0;
+    }
+    return 1;
+};
+count = 0;
+do {
+    count += 1;
+} while count < 0;
+more = 10;
+do {
+    more -= 3;
+} while more > 0;
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[collatz(27) - 111];
+z = check[sign(-5) + sign(0) + sign(8)];
+z = check[count - 1];
+z = check[more + 2];
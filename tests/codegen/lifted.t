@@ -0,0 +1,23 @@
+/*
+Functions that capture nothing, or only program symbols that are bound
+once, are lifted: they read those symbols as C globals and their closures
+have no environment. A function that captures a symbol that changes still
+gets an environment.
+*/
+// expect-c: var_pure = \(closure_[A-Za-z0-9]+\)\{ func[0-9]+, NULL \}
+// expect-c: var_tag = \(closure_[A-Za-z0-9]+\)\{ func[0-9]+, NULL \}
+// expect-c: static class_string var_prefix
+// expect-no-c: capture->var_prefix
+// expect-c: var_adds = \(closure_[A-Za-z0-9]+\)\{ func[0-9]+, &temp
+prefix = "p";
+pure = func(x: int) => int { return x + 1; };
+tag = func(s: string) => string { return prefix + s; };
+total = 0;
+adds = func(x: int) => none { total += x; };
+adds(pure(1));
+adds(pure(2));
+t = tag("q");
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[total - 5];
+z = check[((t == "pq") => int) - 1];
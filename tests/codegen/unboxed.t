@@ -0,0 +1,24 @@
+/*
+Values of int, double and bool are raw C values, not boxed objects, both in
+variables and across calls.
+*/
+// expect-c: int64_t var_i
+// expect-c: double var_d
+// expect-c: unsigned char var_b
+// expect-no-c: class_(int|bool|double)[^_]
+scale = func(x: int, by: double) => double {
+    return (x => double) * by;
+};
+i = 7;
+i -= 10;
+i *= -4;
+i /= 5;
+d = scale(i, 2.5);
+b = d > 5.;
+s = i => string;
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[i - 2];
+z = check[(d => int) - 5];
+z = check[(b => int) - 0];
+z = check[((s == "2") => int) - 1];
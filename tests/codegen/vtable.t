@@ -0,0 +1,22 @@
+/*
+Strings share the one static vtable of their class in the runtime library,
+instead of each instance or program getting its own.
+*/
+// expect-c: &vtable_string
+// expect-no-c: struct vtable_string \{
+// expect-no-c: malloc\(sizeof\(struct vtable
+greet = func(name: string) => string {
+    s = "hi " + name;
+    s += "!";
+    return s;
+};
+a = greet("x");
+b = greet("y");
+same = a == "hi x!";
+differ = a != b;
+copy = a => string;
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[(same => int) - 1];
+z = check[(differ => int) - 1];
+z = check[((copy == a) => int) - 1];
@@ -0,0 +1,32 @@
+/*
+A closure that is created and only called inside a block lives on that
+block's stack. One assigned to a symbol of an enclosing block can be called
+after the block exits, so its environment must not be.
+*/
+n = 0;
+i = 0;
+while i < 4 {
+    g = func() => none { n += i; };
+    g();
+    i += 1;
+}
+h = func() => none { };
+if n > 0 {
+    k = 10;
+    h = func() => none { n += k; };
+}
+h();
+sum = func(m: int) => int {
+    t = 0;
+    j = 0;
+    while j < m {
+        add = func() => none { t += j; };
+        add();
+        j += 1;
+    }
+    return t;
+};
+n += sum(4);
+// Indexing out of bounds exits with an error unless n == 22.
+check = new int[1];
+z = check[n - 22];
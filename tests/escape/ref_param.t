@@ -0,0 +1,15 @@
+/*
+A closure assigned through a ref parameter outlives the call that creates it,
+so its environment can't be on that call's stack.
+*/
+a = 1;
+x = 2;
+baz = func(fn: ref func() => none) => none {
+    fn = func() => none { a += x; };
+};
+g = func() => none { };
+baz(ref g);
+g();
+// Indexing out of bounds exits with an error unless a == 3.
+check = new int[1];
+z = check[a - 3];
@@ -0,0 +1,14 @@
+/*
+Folding int operators wraps around on overflow like two's complement
+arithmetic, and the smallest int is still emitted as valid C.
+*/
+min = 9223372036854775807 + 1;
+max = 0 - 9223372036854775807 - 1 - 1;
+square = 3037000500 * 3037000500;
+back = 9223372036854775807 + 1 - 1;
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[min - (0 - 9223372036854775807 - 1)];
+z = check[max - 9223372036854775807];
+z = check[square - (0 - 9223372036709301616)];
+z = check[back - 9223372036854775807];
@@ -0,0 +1,78 @@
+# Compile a T program with tlang2, build the generated C against the runtime
+# and run it. Any diagnostic from the sanitizers fails the test. Lines of the
+# program of the form
+#   // expect-c: <regex>
+#   // expect-no-c: <regex>
+# check that the generated C does or doesn't match the regular expression.
+# A program with lines of the form
+#   // expect-error: <regex>
+# is one that tlang2 rejects, with one diagnostic for each of them that
+# matches it. It isn't compiled or run. A line of the form
+#   // expect-fail: <regex>
+# means that the program has to exit with an error that matches it.
+#   cmake -DTLANG2=... -DSOURCE=... -DOUTPUT=... -DCC=... -DCFLAGS=...
+#         -DRUNTIME_DIR=... -DRUNTIME_LIB=... -P run_program.cmake
+execute_process(
+        COMMAND ${TLANG2} -o ${OUTPUT}.c ${SOURCE}
+        OUTPUT_QUIET
+        ERROR_VARIABLE diagnostics
+        RESULT_VARIABLE status)
+if (status)
+    message(FATAL_ERROR "tlang2 failed on ${SOURCE}:\n${diagnostics}")
+endif ()
+file(STRINGS ${SOURCE} errors REGEX "^// expect-error: ")
+if (errors)
+    string(REGEX MATCHALL "[^\n ]+:[0-9]+:[0-9]+-[0-9]+:[0-9]+: "
+            locations "${diagnostics}")
+    list(LENGTH locations nlocations)
+    list(LENGTH errors nerrors)
+    if (NOT nlocations EQUAL nerrors)
+        message(FATAL_ERROR "tlang2 reported ${nlocations} errors instead "
+                "of ${nerrors}:\n${diagnostics}")
+    endif ()
+    foreach (error ${errors})
+        string(REGEX REPLACE "^// expect-error: " "" regex "${error}")
+        if (NOT diagnostics MATCHES "${regex}")
+            message(FATAL_ERROR
+                    "tlang2 didn't report ${regex}:\n${diagnostics}")
+        endif ()
+    endforeach ()
+    return()
+elseif (NOT diagnostics STREQUAL "")
+    message(FATAL_ERROR "tlang2 reported errors:\n${diagnostics}")
+endif ()
+file(READ ${OUTPUT}.c code)
+file(STRINGS ${SOURCE} expectations REGEX "^// expect-(no-)?c: ")
+foreach (expectation ${expectations})
+    string(REGEX REPLACE "^// expect-(no-)?c: " "" regex "${expectation}")
+    string(REGEX MATCH "${regex}" match "${code}")
+    if (expectation MATCHES "^// expect-c: " AND match STREQUAL "")
+        message(FATAL_ERROR "${OUTPUT}.c doesn't match ${regex}")
+    elseif (expectation MATCHES "^// expect-no-c: " AND NOT match STREQUAL "")
+        message(FATAL_ERROR "${OUTPUT}.c matches ${regex}: ${match}")
+    endif ()
+endforeach ()
+separate_arguments(CFLAGS)
+execute_process(
+        COMMAND ${CC} ${CFLAGS} -I${RUNTIME_DIR} ${OUTPUT}.c ${RUNTIME_LIB}
+        -lm -o ${OUTPUT}
+        RESULT_VARIABLE status)
+if (status)
+    message(FATAL_ERROR "${OUTPUT}.c failed to compile")
+endif ()
+set(ENV{ASAN_OPTIONS} "detect_stack_use_after_return=1:detect_leaks=0")
+execute_process(
+        COMMAND ${OUTPUT}
+        ERROR_VARIABLE output
+        RESULT_VARIABLE status)
+file(STRINGS ${SOURCE} failure REGEX "^// expect-fail: ")
+if (failure)
+    string(REGEX REPLACE "^// expect-fail: " "" regex "${failure}")
+    if (NOT status OR NOT output MATCHES "${regex}")
+        message(FATAL_ERROR
+                "${OUTPUT} exited with ${status} instead of failing with "
+                "${regex}:\n${output}")
+    endif ()
+elseif (status)
+    message(FATAL_ERROR "${OUTPUT} exited with ${status}:\n${output}")
+endif ()
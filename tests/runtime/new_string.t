@@ -0,0 +1,14 @@
+/*
+Builtin classes have no value at run time, so new calls the runtime's
+constructor directly. A new string is empty.
+*/
+s = new string();
+s += "x";
+t = new string() + s + "y";
+n = new int();
+b = new bool();
+d = new double();
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[((t == "xy") => int) - 1];
+z = check[n + (b => int) + (d => int)];
@@ -0,0 +1,19 @@
+/*
+Only the function signatures that the emitted code spells get a typedef and
+a closure struct, not those of every operator and cast of the builtins.
+*/
+// expect-c: typedef int64_t FUNC_F3intR3intE\(void \*env, int64_t\);
+// expect-no-c: FUNC_FR6doubleE
+// expect-no-c: FUNC_F6stringR4boolE
+// expect-no-c: overload_
+twice = func(x: int) => int {
+    return x + x;
+};
+apply = func(f: func(int) => int, x: int) => int {
+    return f(x);
+};
+n = apply(twice, 21);
+s = "a" + "b";
+// Indexing out of bounds exits with an error unless n == 42.
+check = new int[1];
+z = check[n - 42];
@@ -0,0 +1,135 @@
+#include "sparse_vector.h"
+#include "vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#define CHECK(cond) { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+            #cond); \
+        failures++; \
+    } \
+}
+
+static int failures = 0;
+
+// Distinct elements, compared by address.
+static int elements[4];
+
+static int
+compare(const void *a, const void *b, const void *data) {
+    (void)data;
+    return a != b;
+}
+
+static const void *
+at(const SparseVector *vec, ull index) {
+    const void *element;
+    SparseVector_at(vec, index, &element);
+    return element;
+}
+
+/*
+ * More runs than fit in the vector's inline storage, each longer than the
+ * last, looked up on both sides of every run boundary.
+ */
+static void
+test_many_runs(void) {
+    const size_t nruns = 50 * VECTOR_INLINE_SIZE;
+    SparseVector *vec = SparseVector();
+    for (size_t i = 0; i < nruns; i++) {
+        SparseVector_append(vec, &elements[i % 4], 1000 + i);
+    }
+    CHECK(nruns == SparseVector_size(vec));
+    ull start = 0;
+    for (size_t i = 0; i < nruns; i++) {
+        ull end = start + 1000 + i;
+        CHECK(i == SparseVector_find(vec, start));
+        CHECK(i == SparseVector_find(vec, end - 1));
+        CHECK(&elements[i % 4] == at(vec, start));
+        CHECK(&elements[i % 4] == at(vec, end - 1));
+        start = end;
+    }
+    CHECK(start == SparseVector_count(vec));
+    const SparseSpan *spans = SparseVector_spans(vec);
+    for (size_t i = 0; i < nruns; i++) {
+        CHECK(&elements[i % 4] == spans[i].element);
+        CHECK(1000 + i == spans[i].count);
+    }
+    delete_SparseVector(vec, NULL);
+}
+
+/*
+ * Repeat counts that don't fit in 32 bits, and a total count just below the
+ * largest unsigned long long.
+ */
+static void
+test_large_counts(void) {
+    const ull big = (ull)UINT_MAX + 2;
+    SparseVector *vec = SparseVector();
+    SparseVector_append(vec, &elements[0], big);
+    SparseVector_append(vec, &elements[1], 1);
+    SparseVector_append(vec, &elements[2], big);
+    CHECK(2 * big + 1 == SparseVector_count(vec));
+    CHECK(&elements[0] == at(vec, 0));
+    CHECK(&elements[0] == at(vec, UINT_MAX));
+    CHECK(&elements[0] == at(vec, big - 1));
+    CHECK(&elements[1] == at(vec, big));
+    CHECK(&elements[2] == at(vec, big + 1));
+    CHECK(&elements[2] == at(vec, 2 * big));
+
+    ull rest = ULLONG_MAX - SparseVector_count(vec) - 1;
+    SparseVector_append(vec, &elements[3], rest);
+    CHECK(ULLONG_MAX - 1 == SparseVector_count(vec));
+    CHECK(&elements[2] == at(vec, 2 * big));
+    CHECK(&elements[3] == at(vec, 2 * big + 1));
+    CHECK(&elements[3] == at(vec, ULLONG_MAX - 2));
+    delete_SparseVector(vec, NULL);
+}
+
+/*
+ * Runs appended after a lookup must be found once the lazy index catches up,
+ * and reducing the vector must rebuild the index.
+ */
+static void
+test_index_updates(void) {
+    SparseVector *vec = SparseVector();
+    for (size_t i = 0; i < 8; i++) {
+        SparseVector_append(vec, &elements[i / 3 % 2], 3);
+    }
+    CHECK(&elements[0] == at(vec, 8));
+    CHECK(&elements[1] == at(vec, 9));
+    SparseVector_append(vec, &elements[2], 5);
+    CHECK(&elements[2] == at(vec, 24));
+    CHECK(&elements[2] == at(vec, 28));
+
+    ull count = SparseVector_count(vec);
+    SparseVector_reduce(vec, compare, NULL, NULL);
+    CHECK(count == SparseVector_count(vec));
+    CHECK(4 == SparseVector_size(vec));
+    CHECK(0 == SparseVector_find(vec, 8));
+    CHECK(1 == SparseVector_find(vec, 9));
+    CHECK(1 == SparseVector_find(vec, 17));
+    CHECK(2 == SparseVector_find(vec, 18));
+    CHECK(3 == SparseVector_find(vec, count - 1));
+    CHECK(&elements[2] == at(vec, count - 1));
+    delete_SparseVector(vec, NULL);
+}
+
+int
+main(void) {
+    test_many_runs();
+    test_large_counts();
+    test_index_updates();
+    if (failures) {
+        fprintf(stderr,
+            "%d check%s failed\n",
+            failures,
+            failures == 1
+                ? ""
+                : "s");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/*
+Switches over ints become C switches, and switches over strings dispatch on
+a perfect hash of the case strings. The first of duplicate cases wins, and
+switches over other values test their cases in order.
+*/
+// expect-c: switch \(temp[0-9]+\) {
+// expect-c: switch \(hash_string\(temp[0-9]+->val, [0-9]+u\) >> [0-9]+\) {
+r = 0;
+i = 0;
+while i < 6 {
+    switch i {
+        case 1 { r += 1; }
+        case 3 { r += 30; }
+        case 1 { r += 1000; }
+        case 5 {
+            k = i * 100;
+            r += k;
+        }
+        default { r += 5000; }
+    }
+    i += 1;
+}
+names = 0;
+j = 0;
+while j < 5 {
+    s = "x";
+    if j == 0 { s = "apple"; }
+    if j == 1 { s = "banana"; }
+    if j == 2 { s = "cherry"; }
+    if j == 3 { s = "a\"b\\c\n"; }
+    switch s {
+        case "apple" { names += 1; }
+        case "banana" { names += 20; }
+        case "cherry" { names += 300; }
+        case "a\"b\\c\n" { names += 4000; }
+        default { names += 50000; }
+    }
+    j += 1;
+}
+d = 2.5;
+dd = 0;
+switch d {
+    case 1.0 { dd = 1; }
+    case 2.5 { dd = 2; }
+}
+nd = 0;
+switch names {
+    default { nd = 7; }
+}
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[r - 15531];
+z = check[names - 54321];
+z = check[dd - 2];
+z = check[nd - 7];
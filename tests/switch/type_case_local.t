@@ -0,0 +1,14 @@
+/*
+The variable of a type case inside a function is a local of the function,
+not a symbol it captures.
+*/
+s = "hi";
+f = func(x: string) => string {
+    switch x {
+        case t is string {
+            return t;
+        }
+    }
+    return x;
+};
+q = f(s);
@@ -0,0 +1,24 @@
+/*
+A type case has to test for a subtype of the switched value's type.
+*/
+// expect-error: case type "Other" is not a sub-type of switched type "A"
+// expect-error: case type "int" is not a sub-type of switched type "string"
+A: class { f: int; };
+B: class { f: int; g: int; };
+C: class { f: int; g: int; h: int; };
+Other: class { o: int; };
+a: A;
+a = new C();
+r = 0;
+switch a {
+    case c is C { r = c.h; }
+    case b is B { r = b.g; }
+    case a2 is A { r = a2.f; }
+}
+switch a {
+    case o is Other { r = o.o; }
+    default { r = 1; }
+}
+switch "s" {
+    case n is int { r = n; }
+}
@@ -0,0 +1,29 @@
+/*
+Builtins have no subclasses, so the type cases of a switch over a builtin
+are resolved while generating code, without testing class IDs.
+*/
+// expect-no-c: vtable->id
+describe = func(s: string) => int {
+    switch s {
+        case t is string {
+            return ((t == "hi") => int) + 1;
+        }
+    }
+    return 0;
+};
+r = 0;
+x = 5;
+switch x {
+    case y is int { r = y * 2; }
+    default { r = 1; }
+}
+d = 0;
+switch 2.5 {
+    default { d = 3; }
+}
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[describe("hi") - 2];
+z = check[describe("ho") - 1];
+z = check[r - 10];
+z = check[d - 3];
@@ -0,0 +1,30 @@
+/*
+Tuples are flat C structs with an array for each run of repeated element
+types, passed and returned by value. Spreading a tuple literal assigns its
+elements directly, without building the tuple.
+*/
+// expect-c: typedef struct tuple_TA5_3int6stringE {
+// expect-c: int64_t f0\[5\];
+// expect-no-c: tuple_TA2_3intE
+swap = func(t: (int, string)) => (string, int) {
+    return (t[1], t[0]);
+};
+t = (1, 2, "s");
+t2 = t[1];
+p, q = *(1, 2);
+r = (1, 2, 3, 4, 5, "x");
+a, b, c, d, e, f = *r;
+k = 3;
+g, h = *(k..2);
+w = (k, 7..3)[2];
+name, n = *swap((4, "y"));
+mk = func() => (int, string) { return (1, "z"); };
+one, zed = *mk();
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[t2 + p + q - 5];
+z = check[a + b + c + d + e - 15];
+z = check[((f == "x") => int) + ((r[5] == "x") => int) - 2];
+z = check[g + h + w - 13];
+z = check[((name == "y") => int) + n - 5];
+z = check[((zed == "z") => int) + one - 2];
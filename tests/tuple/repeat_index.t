@@ -0,0 +1,20 @@
+/*
+Tuple types store runs of repeated element types. Indexing finds the run
+that holds an index, on both sides of every run boundary.
+*/
+r = (1..300, true..400, 2.5..50, 3, "x");
+a = r[0];
+b = r[299];
+c = r[300];
+d = r[699];
+e = r[700];
+f = r[749];
+g = r[750];
+h = r[751];
+// Indexing out of bounds exits with an error unless every check holds.
+check = new int[1];
+z = check[a + b - 2];
+z = check[(c => int) + (d => int) - 2];
+z = check[((e + f) => int) - 5];
+z = check[g - 3];
+z = check[((h == "x") => int) - 1];
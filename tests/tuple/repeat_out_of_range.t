@@ -0,0 +1,7 @@
+/*
+The count of a tuple type is the sum of its runs' repeat counts.
+*/
+// expect-error: tuple indexed at 752 is out of range, tuple has 752 elements
+r = (1..300, true..400, 2.5..50, 3, "x");
+h = r[751];
+i = r[752];
@@ -0,0 +1,20 @@
+/*
+Object and none types are shared canonical instances. Declared symbols are
+initialized one at a time, and ref parameters of a type stay distinct from
+plain ones.
+*/
+a: int;
+b: int;
+a = 1;
+b = a + 2;
+flag: bool;
+flag = true;
+inc = func(x: ref int) => none { x += 1; };
+inc(ref b);
+same = func(x: int) => int { return x; };
+g = same;
+nothing = func() => none { };
+nothing();
+// Indexing out of bounds exits with an error unless b == 4 and flag.
+check = new int[1];
+z = check[g(b) + (flag => int) - 5];
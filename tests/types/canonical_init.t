@@ -0,0 +1,9 @@
+/*
+Object and none types are shared canonical instances, so initializing a
+declared symbol must not initialize the other symbols of its type.
+*/
+// expect-error: variable "b" used before initialization
+a: int;
+b: int;
+a = 1;
+c = b + a;
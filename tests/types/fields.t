@@ -0,0 +1,71 @@
+/*
+Class compatibility first rejects classes by the fingerprints and counts of
+their field names, then merges their sorted fields. Classes with many fields
+have most bits of their fingerprints set, so they are mostly told apart by
+the merge.
+*/
+// expect-error: variable "x" from type "X" to type "Y"
+// expect-error: variable "y" from type "Y" to type "Z"
+// expect-error: variable "a" from type "AllButOne" to type "Narrow"
+// expect-error: variable "w" from type "Wide" to type "AllButOne"
+// expect-error: variable "s" from type "Short" to type "Other"
+X: class { a: int; b: int; };
+Y: class { a: int; b: string; };
+Z: class { b: string; c: int; };
+Wide: class {
+    w0: int; w1: int; w2: int; w3: int; w4: int; w5: int; w6: int;
+    w7: int; w8: int; w9: int; w10: int; w11: int; w12: int; w13: int;
+    w14: int; w15: int; w16: int; w17: int; w18: int; w19: int; w20: int;
+    w21: int; w22: int; w23: int; w24: int; w25: int; w26: int; w27: int;
+    w28: int; w29: int; w30: int; w31: int; w32: int; w33: int; w34: int;
+    w35: int; w36: int; w37: int; w38: int; w39: int; w40: int; w41: int;
+    w42: int; w43: int; w44: int; w45: int; w46: int; w47: int; w48: int;
+    w49: int; w50: int; w51: int; w52: int; w53: int; w54: int; w55: int;
+    w56: int; w57: int; w58: int; w59: int; w60: int; w61: int; w62: int;
+    w63: int; w64: int; w65: int; w66: int; w67: int; w68: int; w69: int;
+    w70: int; w71: int; w72: int; w73: int; w74: int; w75: int; w76: int;
+    w77: int; w78: int; w79: int; w80: int; w81: int; w82: int; w83: int;
+    w84: int; w85: int; w86: int; w87: int; w88: int; w89: int; w90: int;
+    w91: int; w92: int; w93: int; w94: int; w95: int; w96: int; w97: int;
+    w98: int; w99: int;
+};
+AllButOne: class {
+    w0: int; w1: int; w2: int; w3: int; w4: int; w5: int; w6: int;
+    w7: int; w8: int; w9: int; w10: int; w11: int; w12: int; w13: int;
+    w14: int; w15: int; w16: int; w17: int; w18: int; w19: int; w20: int;
+    w21: int; w22: int; w23: int; w24: int; w25: int; w26: int; w27: int;
+    w28: int; w29: int; w30: int; w31: int; w32: int; w33: int; w34: int;
+    w35: int; w36: int; w37: int; w38: int; w39: int; w40: int; w41: int;
+    w42: int; w43: int; w44: int; w45: int; w46: int; w47: int; w48: int;
+    w49: int; w50: int; w51: int; w52: int; w53: int; w54: int; w55: int;
+    w56: int; w58: int; w59: int; w60: int; w61: int; w62: int; w63: int;
+    w64: int; w65: int; w66: int; w67: int; w68: int; w69: int; w70: int;
+    w71: int; w72: int; w73: int; w74: int; w75: int; w76: int; w77: int;
+    w78: int; w79: int; w80: int; w81: int; w82: int; w83: int; w84: int;
+    w85: int; w86: int; w87: int; w88: int; w89: int; w90: int; w91: int;
+    w92: int; w93: int; w94: int; w95: int; w96: int; w97: int; w98: int;
+    w99: int;
+};
+Narrow: class {
+    w0: int; w7: int; w14: int; w21: int; w28: int; w35: int; w42: int;
+    w49: int; w56: int; w63: int; w70: int; w77: int; w84: int; w91: int;
+    w98: int;
+};
+Short: class { a: int; };
+Other: class { b: int; c: int; };
+x = new X();
+y = new Y();
+x = y;
+y = new Z();
+w = new Wide();
+a: AllButOne;
+a = w;
+n: Narrow;
+n = w;
+n = a;
+a = n;
+w = a;
+s: Short;
+s = new X();
+s = new Y();
+s = new Other();
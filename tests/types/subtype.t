@@ -0,0 +1,30 @@
+/*
+Classes are subtypes of the classes whose fields they have, through fields
+of class types and transitively. Comparisons are memoized per pair of
+classes, so repeating a rejected one is rejected again.
+*/
+// expect-error: variable "b" from type "B" to type "A"
+// expect-error: variable "d" from type "D" to type "A"
+// expect-error: variable "hc" from type "HoldsC" to type "HoldsA"
+// expect-error: variable "b" from type "B" to type "A"
+A: class { f: int; };
+B: class { f: int; g: int; };
+C: class { f: int; g: int; h: string; };
+D: class { h: string; };
+HoldsA: class { x: A; };
+HoldsC: class { x: C; y: int; };
+c = new C();
+b: B;
+b = c;
+a: A;
+a = b;
+a = c;
+d: D;
+d = c;
+hc = new HoldsC();
+ha: HoldsA;
+ha = hc;
+b = a;
+d = a;
+hc = ha;
+b = a;